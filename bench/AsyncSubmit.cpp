@@ -0,0 +1,104 @@
+#include "Engine.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Throughput of small jobs from many caller threads
+///
+///   - "locked" : Engine::Compute( BufferRange, BufferRange ) behind a mutex (the engine is not
+///                thread-safe), every job is one submission and one fence wait
+///   - "async"  : Engine::SubmitAsync(), each caller waits for its own future before the next job,
+///                the jobs queued meanwhile by the other callers share a submission
+///
+/// Every caller has its own input and output (one workgroup of elements by default).
+///
+/// Usage: async-bench-exec [jobs per caller] [elements]
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+template<typename Job>
+double JobsPerSecond( size_t callerCount, size_t jobsPerCaller, Job&& job )
+{
+    auto start = Clock::now();
+    std::vector<std::thread> callers;
+    for( size_t c = 0; c < callerCount; ++c )
+    {
+        callers.emplace_back( [&, c](){
+            for( size_t j = 0; j < jobsPerCaller; ++j )
+                job( c );
+        } );
+    }
+    for( auto& caller : callers )
+        caller.join();
+
+    auto seconds = std::chrono::duration<double>( Clock::now() - start ).count();
+    return static_cast<double>( callerCount * jobsPerCaller ) / seconds;
+}
+
+} // namespace
+
+int main( int argc, char** argv )
+{
+    size_t jobsPerCaller = argc > 1 ? std::strtoull( argv[1], nullptr, 10 ) : 1000;
+    size_t elementCount = argc > 2 ? std::strtoull( argv[2], nullptr, 10 ) : 0;
+
+    try
+    {
+        Engine engine;
+        if( elementCount == 0 )
+            elementCount = engine.GetKernelConfig().GetElementsPerGroup();
+        if( jobsPerCaller == 0 )
+        {
+            std::cerr << "Usage: async-bench-exec [jobs per caller] [elements]\n";
+            return EXIT_FAILURE;
+        }
+
+        constexpr size_t kMaxCallers = 64;
+        auto bytes = elementCount * sizeof(uint32_t);
+        std::vector<uint32_t> input( elementCount, 1 );
+        std::vector<BufferRange> inputs( kMaxCallers );
+        std::vector<BufferRange> outputs( kMaxCallers );
+        for( size_t c = 0; c < kMaxCallers; ++c )
+        {
+            inputs[c] = engine.AllocateBuffer( bytes, BufferIntent::eDeviceLocal );
+            outputs[c] = engine.AllocateBuffer( bytes, BufferIntent::eDeviceLocal );
+            engine.Upload( inputs[c], 0, input.data(), bytes );
+        }
+        engine.FlushTransfers();
+
+        std::mutex engineMutex;
+        std::cout << "elements " << elementCount << ", " << jobsPerCaller << " jobs per caller\n";
+        for( size_t callerCount = 1; callerCount <= kMaxCallers; callerCount *= 4 )
+        {
+            auto locked = JobsPerSecond( callerCount, jobsPerCaller, [&]( size_t c ){
+                std::lock_guard<std::mutex> lock( engineMutex );
+                engine.Compute( inputs[c], outputs[c] );
+            } );
+            auto async = JobsPerSecond( callerCount, jobsPerCaller, [&]( size_t c ){
+                engine.SubmitAsync( inputs[c], outputs[c] ).get();
+            } );
+
+            std::cout << "  " << callerCount << " callers: locked " << locked << " jobs/s, async " << async << " jobs/s\n";
+        }
+
+        for( size_t c = 0; c < kMaxCallers; ++c )
+        {
+            engine.FreeBuffer( inputs[c] );
+            engine.FreeBuffer( outputs[c] );
+        }
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
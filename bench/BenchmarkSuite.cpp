@@ -0,0 +1,244 @@
+#include "Engine.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+/// Sweep of Engine over element counts, memory strategies and dispatch modes
+///
+///   - "single"   : Compute( span, span ), one submission per job (upload, dispatch, download)
+///   - "batched"  : the job lives in engine memory (AllocateBuffer), its copies are batched by
+///                  FlushTransfers() around Compute( BufferRange, BufferRange )
+///   - "pipelined": ComputeStreaming(), chunks spread over the submission ring (host-visible only,
+///                  the slots stream through mapped memory)
+///   - "single" on "cpu": Compute( span, span ) on the CPU backend, to place the crossover
+///
+/// Every configuration reports the median and p99 latency of a job, GB/s (input + output bytes)
+/// and elements/s, as CSV (default) or JSON. It only needs a Vulkan 1.3 device, lavapipe included.
+///
+/// Usage: bench-exec [--min N] [--max N] [--runs N] [--format csv|json] [--output file]
+
+namespace
+{
+
+struct Options
+{
+    size_t      minElements = 1 << 10;
+    size_t      maxElements = size_t(512) << 20;
+    size_t      runs = 20;                      // For the small jobs, the big ones have fewer (at least 3)
+    std::string format = "csv";
+    std::string outputPath;                     // Empty: stdout
+};
+
+struct Result
+{
+    std::string mode;
+    std::string memory;
+    size_t      elements = 0;
+    size_t      runs = 0;
+    double      medianSeconds = 0.0;
+    double      p99Seconds = 0.0;
+    double      gigabytesPerSecond = 0.0;
+    double      elementsPerSecond = 0.0;
+    std::string error;                          // Not empty if the configuration could not run (out of memory, ...)
+};
+
+constexpr size_t kStreamChunkSize = 1 << 20;
+constexpr size_t kElementsPerRunBudget = size_t(1) << 28;  // Fewer runs for big jobs, so the sweep ends in reasonable time
+
+Options ParseOptions( int argc, char** argv )
+{
+    auto options = Options{};
+    for( int i = 1; i + 1 < argc; i += 2 )
+    {
+        std::string name = argv[i];
+        std::string value = argv[i + 1];
+        if( name == "--min" )
+            options.minElements = std::strtoull( value.c_str(), nullptr, 10 );
+        else if( name == "--max" )
+            options.maxElements = std::strtoull( value.c_str(), nullptr, 10 );
+        else if( name == "--runs" )
+            options.runs = std::strtoull( value.c_str(), nullptr, 10 );
+        else if( name == "--format" )
+            options.format = value;
+        else if( name == "--output" )
+            options.outputPath = value;
+        else
+            throw std::runtime_error( "Unknown option: " + name );
+    }
+
+    if( options.minElements == 0 || options.minElements > options.maxElements || options.runs == 0 )
+        throw std::runtime_error("Invalid options");
+    if( options.format != "csv" && options.format != "json" )
+        throw std::runtime_error("Format is csv or json");
+    return options;
+}
+
+/// One warm-up, then the latency of every run
+Result Measure( const std::string& mode, const std::string& memory, size_t elements, size_t runs, const std::function<void()>& job )
+{
+    auto result = Result{ mode, memory, elements };
+    try
+    {
+        job();
+
+        std::vector<double> seconds( runs );
+        for( auto& s : seconds )
+        {
+            auto start = std::chrono::steady_clock::now();
+            job();
+            s = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+        }
+        std::sort( seconds.begin(), seconds.end() );
+
+        result.runs = runs;
+        result.medianSeconds = seconds[seconds.size() / 2];
+        result.p99Seconds = seconds[std::min( seconds.size() - 1, seconds.size() * 99 / 100 )];
+
+        auto bytes = static_cast<double>( elements ) * ( sizeof(uint32_t) + sizeof(float) );
+        result.gigabytesPerSecond = bytes / result.medianSeconds * 1e-9;
+        result.elementsPerSecond = static_cast<double>( elements ) / result.medianSeconds;
+    }
+    catch( const std::exception& e )
+    {
+        result.error = e.what();
+    }
+    return result;
+}
+
+void RunSize( Engine& engine, size_t elements, size_t runs, std::vector<Result>& results )
+{
+    std::vector<uint32_t> input( elements );
+    std::vector<float> output( elements );
+    std::iota( input.begin(), input.end(), 0 );
+
+    engine.SetBackend( Backend::eCpu );
+    results.push_back( Measure( "single", "cpu", elements, runs, [&]() {
+        engine.Compute( input, output );
+    } ) );
+
+    // The rest measures Vulkan, whatever the size
+    engine.SetBackend( Backend::eGpu );
+    const std::pair<const char*, MemoryStrategy> strategies[] = {
+        { "host-visible", MemoryStrategy::eHostVisible },
+        { "device-local", MemoryStrategy::eDeviceLocal },
+    };
+
+    for( const auto& [memory, strategy] : strategies )
+    {
+        engine.SetMemoryStrategy( strategy );
+        results.push_back( Measure( "single", memory, elements, runs, [&]() {
+            engine.Compute( input, output );
+        } ) );
+
+        /// Device-local buffers are filled through the staging rings, host-visible ones are written in place
+        bool deviceLocal = strategy == MemoryStrategy::eDeviceLocal;
+        BufferRange inputRange;
+        BufferRange outputRange;
+        results.push_back( Measure( "batched", memory, elements, runs, [&]() {
+            if( inputRange.size == 0 )
+            {
+                inputRange = engine.AllocateBuffer( input.size() * sizeof(uint32_t), deviceLocal ? BufferIntent::eDeviceLocal : BufferIntent::eUpload );
+                outputRange = engine.AllocateBuffer( output.size() * sizeof(float), deviceLocal ? BufferIntent::eDeviceLocal : BufferIntent::eReadback );
+            }
+            engine.Upload( inputRange, 0, input.data(), input.size() * sizeof(uint32_t) );
+            engine.FlushTransfers();
+            engine.Compute( inputRange, outputRange );
+            engine.Download( outputRange, 0, output.data(), output.size() * sizeof(float) );
+            engine.FlushTransfers();
+        } ) );
+        if( inputRange.size != 0 )
+            engine.FreeBuffer( inputRange );
+        if( outputRange.size != 0 )
+            engine.FreeBuffer( outputRange );
+    }
+
+    results.push_back( Measure( "pipelined", "host-visible", elements, runs, [&]() {
+        engine.ComputeStreaming( input, output, kStreamChunkSize );
+    } ) );
+}
+
+void WriteCsv( std::ostream& out, const std::vector<Result>& results )
+{
+    out << "mode,memory,elements,runs,median_ms,p99_ms,gb_per_s,elements_per_s,error\n";
+    for( const auto& r : results )
+    {
+        out << r.mode << "," << r.memory << "," << r.elements << "," << r.runs << ","
+            << r.medianSeconds * 1e3 << "," << r.p99Seconds * 1e3 << ","
+            << r.gigabytesPerSecond << "," << r.elementsPerSecond << ",\"" << r.error << "\"\n";
+    }
+}
+
+void WriteJson( std::ostream& out, const std::vector<Result>& results )
+{
+    out << "[\n";
+    for( size_t i = 0; i < results.size(); ++i )
+    {
+        const auto& r = results[i];
+        out << "  {\"mode\":\"" << r.mode << "\",\"memory\":\"" << r.memory << "\",\"elements\":" << r.elements
+            << ",\"runs\":" << r.runs << ",\"median_ms\":" << r.medianSeconds * 1e3 << ",\"p99_ms\":" << r.p99Seconds * 1e3
+            << ",\"gb_per_s\":" << r.gigabytesPerSecond << ",\"elements_per_s\":" << r.elementsPerSecond;
+        if( !r.error.empty() )
+            out << ",\"error\":\"" << r.error << "\"";
+        out << "}" << ( i + 1 < results.size() ? ",\n" : "\n" );
+    }
+    out << "]\n";
+}
+
+} // namespace
+
+int main( int argc, char** argv )
+{
+    try
+    {
+        auto options = ParseOptions( argc, argv );
+
+        std::vector<size_t> sizes;
+        for( size_t elements = options.minElements; elements <= options.maxElements; elements *= 2 )
+            sizes.push_back( elements );
+
+        Engine engine;
+        std::vector<Result> results;
+
+        // The biggest first: the engine keeps its grown buffers and pool blocks, so the smaller
+        // sizes reuse them instead of adding new ones next to them
+        for( auto it = sizes.rbegin(); it != sizes.rend(); ++it )
+        {
+            auto runs = std::clamp<size_t>( kElementsPerRunBudget / *it, 3, std::max<size_t>( options.runs, 3 ) );
+            std::cerr << "elements " << *it << " (" << runs << " runs)\n";
+            RunSize( engine, *it, runs, results );
+        }
+
+        std::stable_sort( results.begin(), results.end(), []( const Result& a, const Result& b ){
+            return a.elements < b.elements;
+        } );
+
+        std::ofstream file;
+        if( !options.outputPath.empty() )
+        {
+            file.open( options.outputPath, std::ios::trunc );
+            if( !file.is_open() )
+                throw std::runtime_error( "Failed to open: " + options.outputPath );
+        }
+        auto& out = options.outputPath.empty() ? std::cout : file;
+
+        if( options.format == "json" )
+            WriteJson( out, results );
+        else
+            WriteCsv( out, results );
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include "Engine.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+/// A chain of kernels as one Engine::Execute() against one Engine::Compute() per stage
+///
+///   - "separate" : every stage is a Compute( BufferRange, BufferRange ), one submission and wait each,
+///                  the intermediates are engine buffers
+///   - "graph"    : the same chain in one submission, the intermediates are transients (two regions
+///                  are enough, they are aliased)
+///   - "fan-out"  : as many stages reading the same input, independent, so they share one wave
+///   - "read-back": a filter (shaders/filter.comp) keeps the even elements, its count is downloaded and
+///                  shader.comp runs over that many elements (two submissions and a wait in between)
+///   - "indirect" : the same two stages in one Execute(), the second one dispatched indirectly over the
+///                  count written by the first one
+///
+/// The stages run shader.comp, the next stage reads the float bits of the previous one as uint: only
+/// the time means something, but both chains have to give the same bits. The filter appends in any
+/// order, the two filtered results are compared sorted.
+///
+/// Usage: graph-bench-exec [stages] [runs]
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+template<typename Job>
+double MedianSeconds( size_t runs, Job&& job )
+{
+    std::vector<double> seconds( runs );
+    for( auto& s : seconds )
+    {
+        auto start = Clock::now();
+        job();
+        s = std::chrono::duration<double>( Clock::now() - start ).count();
+    }
+    std::nth_element( seconds.begin(), seconds.begin() + seconds.size() / 2, seconds.end() );
+    return seconds[seconds.size() / 2];
+}
+
+constexpr size_t kFilterHeader = 256;   // Bytes before the values of filter.comp, its DispatchArgs first
+
+/// Part of an engine range (offset aligned for storage buffers)
+BufferRange SubRange( BufferRange range, size_t offset, size_t size )
+{
+    range.offset += offset;
+    range.size = size;
+    if( range.pMapped )
+        range.pMapped = static_cast<char*>( range.pMapped ) + offset;
+    if( range.address != 0 )
+        range.address += offset;
+    return range;
+}
+
+} // namespace
+
+int main( int argc, char** argv )
+{
+    size_t stageCount = argc > 1 ? std::strtoull( argv[1], nullptr, 10 ) : 5;
+    size_t runs = argc > 2 ? std::strtoull( argv[2], nullptr, 10 ) : 20;
+    if( stageCount == 0 || runs == 0 )
+    {
+        std::cerr << "Usage: graph-bench-exec [stages] [runs]\n";
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        Engine engine;
+        engine.SetBackend( Backend::eGpu );
+
+        for( size_t count = size_t(1) << 12; count <= size_t(1) << 24; count *= 16 )
+        {
+            auto bytes = count * sizeof(uint32_t);
+            std::vector<uint32_t> input( count );
+            for( size_t i = 0; i < count; ++i )
+                input[i] = static_cast<uint32_t>( i % 1021 );
+
+            std::vector<BufferRange> chain( stageCount + 1 );
+            for( auto& range : chain )
+                range = engine.AllocateBuffer( bytes, BufferIntent::eDeviceLocal );
+            auto output = engine.AllocateBuffer( bytes, BufferIntent::eDeviceLocal );
+            engine.Upload( chain[0], 0, input.data(), bytes );
+            engine.FlushTransfers();
+
+            ComputeGraph graph;
+            {
+                auto previous = graph.AddBuffer( chain[0] );
+                for( size_t s = 0; s < stageCount; ++s )
+                {
+                    auto next = s + 1 < stageCount ? graph.AddTransient( bytes ) : graph.AddBuffer( output );
+                    graph.AddStage( previous, next );
+                    previous = next;
+                }
+            }
+            ComputeGraph fanOut;
+            {
+                auto source = fanOut.AddBuffer( chain[0] );
+                for( size_t s = 0; s < stageCount; ++s )
+                    fanOut.AddStage( source, fanOut.AddBuffer( chain[s + 1] ) );
+            }
+
+            auto separate = MedianSeconds( runs, [&](){
+                for( size_t s = 0; s < stageCount; ++s )
+                    engine.Compute( chain[s], chain[s + 1] );
+            } );
+            std::vector<uint32_t> expected( count );
+            engine.Download( chain[stageCount], 0, expected.data(), bytes );    // Before the fan-out overwrites it
+            engine.FlushTransfers();
+
+            auto fused = MedianSeconds( runs, [&](){ engine.Execute( graph ); } );
+            auto parallel = MedianSeconds( runs, [&](){ engine.Execute( fanOut ); } );
+
+            std::vector<uint32_t> result( count );
+            engine.Download( output, 0, result.data(), bytes );
+            engine.FlushTransfers();
+            bool match = expected == result;
+
+            /// Filter then compute, the size of the second stage only known on the GPU
+            auto compacted = engine.AllocateBuffer( kFilterHeader + bytes, BufferIntent::eDeviceLocal );
+            auto filterArgs = SubRange( compacted, 0, sizeof(DispatchArgs) );
+            auto filtered = SubRange( compacted, kFilterHeader, bytes );
+            auto clearArgs = [&](){
+                auto args = DispatchArgs{};
+                engine.Upload( filterArgs, 0, &args, sizeof(args) );
+                engine.FlushTransfers();
+            };
+            auto filterKernel = ShaderSource{ std::string(SHADER_PATH) + std::string("/filter.comp") };
+
+            ComputeGraph filterGraph;
+            filterGraph.AddStage( filterKernel, filterGraph.AddBuffer( chain[0] ), filterGraph.AddBuffer( compacted ) );
+            ComputeGraph indirectGraph;
+            {
+                auto compactedId = indirectGraph.AddBuffer( compacted );
+                indirectGraph.AddStage( filterKernel, indirectGraph.AddBuffer( chain[0] ), compactedId );
+                indirectGraph.AddIndirectStage( indirectGraph.AddBuffer( filtered ), indirectGraph.AddBuffer( output ), indirectGraph.AddBuffer( filterArgs ) );
+            }
+
+            uint32_t readBackCount = 0;
+            auto readBack = MedianSeconds( runs, [&](){
+                clearArgs();
+                engine.Execute( filterGraph );
+                engine.Download( filterArgs, offsetof( DispatchArgs, count ), &readBackCount, sizeof(readBackCount) );
+                engine.FlushTransfers();
+                if( readBackCount != 0 )
+                    engine.Compute( SubRange( filtered, 0, readBackCount * sizeof(uint32_t) ), output );
+            } );
+            std::vector<float> expectedFiltered( readBackCount );
+            engine.Download( output, 0, expectedFiltered.data(), readBackCount * sizeof(float) );
+            engine.FlushTransfers();
+
+            auto indirect = MedianSeconds( runs, [&](){
+                clearArgs();
+                engine.Execute( indirectGraph );
+            } );
+            auto args = DispatchArgs{};
+            engine.Download( filterArgs, 0, &args, sizeof(args) );
+            std::vector<float> resultFiltered( readBackCount );
+            engine.Download( output, 0, resultFiltered.data(), readBackCount * sizeof(float) );
+            engine.FlushTransfers();
+            std::sort( expectedFiltered.begin(), expectedFiltered.end() );
+            std::sort( resultFiltered.begin(), resultFiltered.end() );
+            bool filterMatch = args.count == readBackCount && expectedFiltered == resultFiltered;
+
+            std::cout << "elements " << count << ", " << stageCount << " stages\n";
+            std::cout << "  separate : " << separate * 1e3 << " ms\n";
+            std::cout << "  graph    : " << fused * 1e3 << " ms" << ( match ? "" : "  MISMATCH" ) << "\n";
+            std::cout << "  fan-out  : " << parallel * 1e3 << " ms\n";
+            std::cout << "  read-back: " << readBack * 1e3 << " ms (" << readBackCount << " filtered)\n";
+            std::cout << "  indirect : " << indirect * 1e3 << " ms" << ( filterMatch ? "" : "  MISMATCH" ) << "\n";
+
+            for( const auto& range : chain )
+                engine.FreeBuffer( range );
+            engine.FreeBuffer( output );
+            engine.FreeBuffer( compacted );
+        }
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+#include "Engine.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+/// Per-dispatch overhead of Engine::Compute()
+///
+/// The job is tiny (one workgroup), so the time is dominated by the submission path
+/// (command buffer recording, fence handling, submit and wait) instead of the kernel.
+///   - "pre-recorded": the same size every call, the ring re-submits the recorded command buffers
+///   - "re-recorded" : the size changes every call, so each call records again (the old behaviour)
+///   - "range pairs" : Compute( BufferRange, BufferRange ) over a new pair of ranges every call, with
+///                     a descriptor set written for each pair, and bindless (device addresses as push
+///                     constants, when the device supports it)
+
+namespace
+{
+
+double MeasureMicroseconds( Engine& engine, std::vector<uint32_t>& input, std::vector<float>& output, int iterations, bool alternateSize )
+{
+    auto inputSpan = std::span<const uint32_t>( input );
+    auto outputSpan = std::span<float>( output );
+
+    // Warming up (first recording of every slot of the ring)
+    for( uint32_t i = 0; i < Engine::kSlotCount; ++i )
+        engine.Compute( inputSpan, outputSpan );
+
+    auto start = std::chrono::steady_clock::now();
+    for( int i = 0; i < iterations; ++i )
+    {
+        auto count = ( alternateSize && ( i & 1 ) ) ? input.size() - 1 : input.size();
+        engine.Compute( inputSpan.first( count ), outputSpan );
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::micro>( end - start ).count() / iterations;
+}
+
+double MeasureRangePairs( Engine& engine, const std::vector<BufferRange>& ranges, int iterations )
+{
+    // Every pair is used once before, the pool memory is touched and the pipelines are warm
+    for( size_t i = 0; i + 1 < ranges.size(); ++i )
+        engine.Compute( ranges[i], ranges[i + 1] );
+
+    auto start = std::chrono::steady_clock::now();
+    for( int i = 0; i < iterations; ++i )
+    {
+        auto first = static_cast<size_t>( i ) % ( ranges.size() - 1 );
+        engine.Compute( ranges[first], ranges[first + 1] );
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::micro>( end - start ).count() / iterations;
+}
+
+} // namespace
+
+int main( int argc, char** argv )
+{
+    int iterations = argc > 1 ? std::atoi( argv[1] ) : 10000;
+
+    try
+    {
+        Engine engine;
+        engine.SetBackend( Backend::eGpu );     // Such a small job would go to the CPU backend
+
+        std::vector<uint32_t> input( engine.GetKernelConfig().GetElementsPerGroup(), 1 );
+        std::vector<float> output( input.size() );
+
+        auto preRecorded = MeasureMicroseconds( engine, input, output, iterations, false );
+        auto reRecorded = MeasureMicroseconds( engine, input, output, iterations, true );
+
+        std::cout << "iterations   : " << iterations << "\n";
+        std::cout << "pre-recorded : " << preRecorded << " us/dispatch\n";
+        std::cout << "re-recorded  : " << reRecorded << " us/dispatch\n";
+
+        // More pairs than slots, so no slot finds its last recording again
+        std::vector<BufferRange> ranges( 4 * Engine::kSlotCount + 1 );
+        for( auto& range : ranges )
+            range = engine.AllocateBuffer( input.size() * sizeof(uint32_t), BufferIntent::eDeviceLocal );
+
+        bool bindless = engine.IsBindlessSupported();
+        engine.EnableBindless( false );
+        auto described = MeasureRangePairs( engine, ranges, iterations );
+        std::cout << "range pairs  : " << described << " us/dispatch (descriptor sets)\n";
+        if( bindless )
+        {
+            engine.EnableBindless( true );
+            auto addressed = MeasureRangePairs( engine, ranges, iterations );
+            std::cout << "range pairs  : " << addressed << " us/dispatch (bindless)\n";
+        }
+
+        for( const auto& range : ranges )
+            engine.FreeBuffer( range );
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "Engine.hpp"
+#include "BinaryFile.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+/// A file through the kernel into another file
+///
+///   - "file"   : Engine::ComputeFile(), chunks read and written between the files and the mapped ring
+///   - "memory" : the whole file read into a vector, ComputeStreaming(), the whole output written (the old way)
+///
+/// The peak resident set size is printed after each one: "file" stays near the size of the ring, "memory"
+/// grows by the size of both files. "file" runs first, the peak never goes down.
+///
+/// Usage: file-bench-exec [megabytes] [chunk elements] [directory]
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+double PeakRssMegabytes()
+{
+    struct rusage usage{};
+    getrusage( RUSAGE_SELF, &usage );
+    return static_cast<double>( usage.ru_maxrss ) / 1024.0;     // Kilobytes on Linux
+}
+
+} // namespace
+
+int main( int argc, char** argv )
+{
+    size_t megabytes = argc > 1 ? std::strtoull( argv[1], nullptr, 10 ) : 1024;
+    size_t chunkSize = argc > 2 ? std::strtoull( argv[2], nullptr, 10 ) : size_t(4) << 20;
+    std::string directory = argc > 3 ? argv[3] : ".";
+    if( megabytes == 0 || chunkSize == 0 )
+    {
+        std::cerr << "Usage: file-bench-exec [megabytes] [chunk elements] [directory]\n";
+        return EXIT_FAILURE;
+    }
+
+    auto inputPath = directory + "/file_bench_input.bin";
+    auto outputPath = directory + "/file_bench_output.bin";
+    try
+    {
+        Engine engine;
+        engine.SetBackend( Backend::eGpu );
+
+        /// The input, written by blocks
+        auto elementCount = ( megabytes << 20 ) / sizeof(uint32_t);
+        {
+            auto input = BinaryFile( inputPath, BinaryFile::Mode::eWrite );
+            input.Resize( elementCount * sizeof(uint32_t) );
+            std::vector<uint32_t> block( chunkSize );
+            for( size_t offset = 0; offset < elementCount; offset += block.size() )
+            {
+                auto count = std::min( block.size(), elementCount - offset );
+                for( size_t i = 0; i < count; ++i )
+                    block[i] = static_cast<uint32_t>( ( offset + i ) % 1021 );
+                input.Write( offset * sizeof(uint32_t), block.data(), count * sizeof(uint32_t) );
+            }
+        }
+        std::cout << "elements " << elementCount << ", chunks of " << chunkSize << "\n";
+        std::cout << "  start  : peak RSS " << PeakRssMegabytes() << " MiB\n";
+
+        auto stats = engine.ComputeFile( inputPath, outputPath, chunkSize );
+        std::cout << "  file   : " << stats.seconds * 1e3 << " ms, " << stats.gigabytesPerSecond << " GB/s, peak RSS "
+                  << PeakRssMegabytes() << " MiB\n";
+
+        /// Checking a sample of the output file
+        {
+            auto output = BinaryFile( outputPath, BinaryFile::Mode::eRead );
+            bool match = output.GetSize() == elementCount * sizeof(float);
+            for( size_t i = 0; match && i < elementCount; i += elementCount / 64 + 1 )
+            {
+                float value = 0.0f;
+                output.Read( i * sizeof(float), &value, sizeof(value) );
+                match = value == static_cast<float>( i % 1021 ) * ComputeGraph::kDefaultScale;
+            }
+            if( !match )
+                std::cout << "  file   : MISMATCH\n";
+        }
+
+        auto start = Clock::now();
+        {
+            std::vector<uint32_t> input( elementCount );
+            std::ifstream( inputPath, std::ios::binary ).read( reinterpret_cast<char*>( input.data() ), elementCount * sizeof(uint32_t) );
+            std::vector<float> output( elementCount );
+            engine.ComputeStreaming( input, output, chunkSize );
+            std::ofstream( outputPath, std::ios::binary ).write( reinterpret_cast<const char*>( output.data() ), elementCount * sizeof(float) );
+        }
+        auto seconds = std::chrono::duration<double>( Clock::now() - start ).count();
+        auto gigabytes = static_cast<double>( elementCount ) * ( sizeof(uint32_t) + sizeof(float) ) * 1e-9;
+        std::cout << "  memory : " << seconds * 1e3 << " ms, " << gigabytes / seconds << " GB/s, peak RSS "
+                  << PeakRssMegabytes() << " MiB\n";
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << e.what() << '\n';
+        std::remove( inputPath.c_str() );
+        std::remove( outputPath.c_str() );
+        return EXIT_FAILURE;
+    }
+
+    std::remove( inputPath.c_str() );
+    std::remove( outputPath.c_str() );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,176 @@
+#include "Engine.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <vector>
+
+/// Engine::Reduce() and Engine::Scan() against std::reduce and std::inclusive_scan
+///
+/// The data already lives in engine memory (device-local), so the GPU side is the kernels and
+/// the submission, not the PCIe bus. Results are checked against the host on uint32_t (the sum
+/// wraps around the same way on both sides). GB/s counts the bytes the algorithm has to touch:
+/// the input for a reduction, input + output for a scan.
+/// A last check runs on a range whose size is not a multiple of the storage buffer alignment, over
+/// the padding of a freed range full of other values: none of it may reach the results.
+///
+/// Usage: library-bench-exec [elements] [runs]
+
+namespace
+{
+
+double MedianSeconds( size_t runs, const std::function<void()>& job )
+{
+    job();  // Warming up (pipelines, pool blocks)
+
+    std::vector<double> seconds( runs );
+    for( auto& s : seconds )
+    {
+        auto start = std::chrono::steady_clock::now();
+        job();
+        s = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    }
+    std::nth_element( seconds.begin(), seconds.begin() + seconds.size() / 2, seconds.end() );
+    return seconds[seconds.size() / 2];
+}
+
+void Report( const char* name, size_t bytes, double hostSeconds, double gpuSeconds, bool match )
+{
+    std::cout << name << ": host " << hostSeconds * 1e3 << " ms (" << bytes / hostSeconds * 1e-9 << " GB/s), "
+              << "engine " << gpuSeconds * 1e3 << " ms (" << bytes / gpuSeconds * 1e-9 << " GB/s)"
+              << ( match ? "" : "  MISMATCH" ) << "\n";
+}
+
+/// Reduce and inclusive scan of kOddCount elements, after a range of kOddCount + 24 large values was freed
+bool CheckOddSize( Engine& engine )
+{
+    constexpr size_t kOddCount = 1000;
+    std::vector<uint32_t> stale( kOddCount + 24, 0xffffffffu );
+    auto staleRange = engine.AllocateBuffer( stale.size() * sizeof(uint32_t), BufferIntent::eDeviceLocal );
+    engine.Upload( staleRange, 0, stale.data(), stale.size() * sizeof(uint32_t) );
+    engine.FlushTransfers();
+    engine.FreeBuffer( staleRange );
+
+    std::vector<uint32_t> input( kOddCount );
+    std::iota( input.begin(), input.end(), 1u );
+    auto inputRange = engine.AllocateBuffer( kOddCount * sizeof(uint32_t), BufferIntent::eDeviceLocal );
+    auto outputRange = engine.AllocateBuffer( kOddCount * sizeof(uint32_t), BufferIntent::eDeviceLocal );
+    engine.Upload( inputRange, 0, input.data(), kOddCount * sizeof(uint32_t) );
+    engine.FlushTransfers();
+
+    bool match = engine.Reduce<uint32_t>( inputRange, ReduceOp::eSum ) == std::reduce( input.begin(), input.end(), uint32_t(0) ) &&
+                 engine.Reduce<uint32_t>( inputRange, ReduceOp::eMax ) == kOddCount;
+
+    std::vector<uint32_t> expected( kOddCount );
+    std::vector<uint32_t> output( kOddCount );
+    std::inclusive_scan( input.begin(), input.end(), expected.begin() );
+    engine.Scan<uint32_t>( inputRange, outputRange, ReduceOp::eSum, ScanMode::eInclusive );
+    engine.Download( outputRange, 0, output.data(), kOddCount * sizeof(uint32_t) );
+    engine.FlushTransfers();
+
+    engine.FreeBuffer( inputRange );
+    engine.FreeBuffer( outputRange );
+    return match && output == expected;
+}
+
+} // namespace
+
+int main( int argc, char** argv )
+{
+    size_t elements = argc > 1 ? std::strtoull( argv[1], nullptr, 10 ) : size_t(1) << 26;
+    size_t runs = argc > 2 ? std::strtoull( argv[2], nullptr, 10 ) : 10;
+    if( elements == 0 || runs == 0 )
+    {
+        std::cerr << "Usage: library-bench-exec [elements] [runs]\n";
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        Engine engine;
+
+        std::vector<uint32_t> input( elements );
+        std::mt19937 random( 42 );
+        std::generate( input.begin(), input.end(), [&random](){ return static_cast<uint32_t>( random() ); } );
+        std::vector<uint32_t> expected( elements );
+        std::vector<uint32_t> output( elements );
+
+        auto bytes = elements * sizeof(uint32_t);
+        auto inputRange = engine.AllocateBuffer( bytes, BufferIntent::eDeviceLocal );
+        auto outputRange = engine.AllocateBuffer( bytes, BufferIntent::eDeviceLocal );
+        engine.Upload( inputRange, 0, input.data(), bytes );
+        engine.FlushTransfers();
+
+        std::cout << "elements : " << elements << " (" << runs << " runs, median)\n";
+
+        /// Reductions
+        const std::pair<const char*, ReduceOp> ops[] = {
+            { "reduce sum", ReduceOp::eSum },
+            { "reduce min", ReduceOp::eMin },
+            { "reduce max", ReduceOp::eMax },
+        };
+        for( const auto& [name, op] : ops )
+        {
+            uint32_t hostResult = 0;
+            uint32_t engineResult = 0;
+            auto hostSeconds = MedianSeconds( runs, [&](){
+                switch( op )
+                {
+                case ReduceOp::eSum:
+                    hostResult = std::reduce( input.begin(), input.end(), uint32_t(0) );
+                    break;
+                case ReduceOp::eMin:
+                    hostResult = *std::min_element( input.begin(), input.end() );
+                    break;
+                case ReduceOp::eMax:
+                    hostResult = *std::max_element( input.begin(), input.end() );
+                    break;
+                }
+            } );
+            auto gpuSeconds = MedianSeconds( runs, [&](){
+                engineResult = engine.Reduce<uint32_t>( inputRange, op );
+            } );
+            Report( name, bytes, hostSeconds, gpuSeconds, hostResult == engineResult );
+        }
+
+        /// Inclusive and exclusive scans (sum)
+        {
+            auto hostSeconds = MedianSeconds( runs, [&](){
+                std::inclusive_scan( input.begin(), input.end(), expected.begin() );
+            } );
+            auto gpuSeconds = MedianSeconds( runs, [&](){
+                engine.Scan<uint32_t>( inputRange, outputRange, ReduceOp::eSum, ScanMode::eInclusive );
+            } );
+            engine.Download( outputRange, 0, output.data(), bytes );
+            engine.FlushTransfers();
+            Report( "inclusive scan", bytes * 2, hostSeconds, gpuSeconds, output == expected );
+        }
+        {
+            auto hostSeconds = MedianSeconds( runs, [&](){
+                std::exclusive_scan( input.begin(), input.end(), expected.begin(), uint32_t(0) );
+            } );
+            auto gpuSeconds = MedianSeconds( runs, [&](){
+                engine.Scan<uint32_t>( inputRange, outputRange, ReduceOp::eSum, ScanMode::eExclusive );
+            } );
+            engine.Download( outputRange, 0, output.data(), bytes );
+            engine.FlushTransfers();
+            Report( "exclusive scan", bytes * 2, hostSeconds, gpuSeconds, output == expected );
+        }
+
+        engine.FreeBuffer( inputRange );
+        engine.FreeBuffer( outputRange );
+
+        std::cout << "odd size (1000 elements): " << ( CheckOddSize( engine ) ? "ok" : "MISMATCH" ) << "\n";
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+#include "MultiEngine.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+/// Scaling of MultiEngine::Compute() with the number of devices
+///
+/// For 1 to N devices: the throughput of the sharded job, the speedup over the first device alone,
+/// and the scaling efficiency, the throughput against the sum of what the same devices reach alone
+/// (1.0 is perfect, whatever the mix of GPUs). The output of every count has to match the one of
+/// the first device alone.
+///
+/// Usage: multi-gpu-bench-exec [elements] [runs]
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+template<typename Job>
+double MedianSeconds( size_t runs, Job&& job )
+{
+    std::vector<double> seconds( runs );
+    for( auto& s : seconds )
+    {
+        auto start = Clock::now();
+        job();
+        s = std::chrono::duration<double>( Clock::now() - start ).count();
+    }
+    std::nth_element( seconds.begin(), seconds.begin() + seconds.size() / 2, seconds.end() );
+    return seconds[seconds.size() / 2];
+}
+
+} // namespace
+
+int main( int argc, char** argv )
+{
+    size_t count = argc > 1 ? std::strtoull( argv[1], nullptr, 10 ) : size_t(1) << 26;
+    size_t runs = argc > 2 ? std::strtoull( argv[2], nullptr, 10 ) : 5;
+    if( count == 0 || runs == 0 )
+    {
+        std::cerr << "Usage: multi-gpu-bench-exec [elements] [runs]\n";
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        MultiEngine engine;
+        auto deviceCount = engine.GetDeviceCount();
+        auto alone = engine.Calibrate();
+
+        std::cout << "devices\n";
+        for( size_t d = 0; d < deviceCount; ++d )
+            std::cout << "  " << d << ": " << engine.GetEngine( d ).GetDeviceName() << ", " << alone[d] / 1e9 << " Gelem/s alone\n";
+
+        std::vector<uint32_t> input( count );
+        for( size_t i = 0; i < count; ++i )
+            input[i] = static_cast<uint32_t>( i % 1021 );
+        std::vector<float> expected( count );
+        std::vector<float> output( count );
+
+        std::cout << "elements " << count << "\n";
+        double single = 0.0;
+        double aloneSum = 0.0;
+        for( size_t active = 1; active <= deviceCount; ++active )
+        {
+            engine.SetActiveDeviceCount( active );
+            aloneSum += alone[active - 1];
+
+            auto& result = active == 1 ? expected : output;
+            ShardedTimings last;
+            auto seconds = MedianSeconds( runs, [&](){ last = engine.Compute( input, result ); } );
+            auto throughput = static_cast<double>( count ) / seconds;
+            if( active == 1 )
+                single = throughput;
+            bool match = active == 1 || output == expected;
+
+            std::cout << "  " << active << " device(s): " << seconds * 1e3 << " ms, " << throughput / 1e9 << " Gelem/s"
+                      << ", speedup " << throughput / single
+                      << ", efficiency " << throughput / aloneSum
+                      << ( match ? "" : "  MISMATCH" ) << "\n";
+            for( size_t d = 0; d < last.shards.size(); ++d )
+                std::cout << "      shard " << d << ": " << last.shards[d].elementCount << " elements, " << last.shards[d].seconds * 1e3 << " ms\n";
+        }
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,145 @@
+#include "Engine.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+/// Reduced-precision storage: Engine::Compute() with uint16_t / uint8_t inputs and half float outputs
+/// against the 32-bit kernel
+///
+/// For every pair of types, the span path (host copies and kernel) and, when the device supports the
+/// types, ranges that already live in engine memory (the kernel alone). GB/s counts the bytes really
+/// moved, "effective" the bytes that the 32-bit kernel moves for the same elements (8 each): the gain
+/// is the effective GB/s over the one of uint32_t -> float. Without the storage features the span path
+/// goes through the host conversion and the ranges are skipped.
+/// The inputs fit in 8 bits and their product by the scale in a half float, every output has to match
+/// the 32-bit result (converted on the host for half floats).
+///
+/// Usage: narrow-bench-exec [elements] [runs]
+
+namespace
+{
+
+constexpr uint32_t kValueRange = 61;    // 60 * 1000 is below 65504, the largest half
+
+double MedianSeconds( size_t runs, const std::function<void()>& job )
+{
+    job();  // Warming up (pipelines, buffers)
+
+    std::vector<double> seconds( runs );
+    for( auto& s : seconds )
+    {
+        auto start = std::chrono::steady_clock::now();
+        job();
+        s = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    }
+    std::nth_element( seconds.begin(), seconds.begin() + seconds.size() / 2, seconds.end() );
+    return seconds[seconds.size() / 2];
+}
+
+bool Matches( const std::vector<float>& output, const std::vector<float>& expected )
+{
+    return output == expected;
+}
+
+bool Matches( const std::vector<Float16>& output, const std::vector<float>& expected )
+{
+    std::vector<Float16> half( expected.size() );
+    FloatToHalf( expected.data(), half.data(), expected.size() );
+    return std::equal( output.begin(), output.end(), half.begin(), []( Float16 a, Float16 b ){ return a.bits == b.bits; } );
+}
+
+void Report( const char* path, size_t elements, size_t bytes, double seconds, double reference, bool match )
+{
+    auto effective = static_cast<double>( elements * ( sizeof(uint32_t) + sizeof(float) ) ) / seconds;
+    std::cout << "    " << path << ": " << seconds * 1e3 << " ms, " << bytes / seconds * 1e-9 << " GB/s"
+              << " (effective " << effective * 1e-9 << " GB/s, x" << reference / seconds << ")"
+              << ( match ? "" : "  MISMATCH" ) << "\n";
+}
+
+/// Seconds of the span and range paths (0: skipped). reference holds the ones of uint32_t -> float,
+/// zeros while measuring them.
+template<typename In, typename Out>
+std::pair<double, double> Run( Engine& engine, const char* name, size_t elements, size_t runs, const std::vector<float>& expected,
+                               std::pair<double, double> reference )
+{
+    std::vector<In> input( elements );
+    for( size_t i = 0; i < elements; ++i )
+        input[i] = static_cast<In>( i % kValueRange );
+    std::vector<Out> output( elements );
+
+    auto inputType = StorageTypeOf<In>::value;
+    auto outputType = StorageTypeOf<Out>::value;
+    auto bytes = elements * ( sizeof(In) + sizeof(Out) );
+    bool native = engine.HasGpu() && engine.IsStorageSupported( inputType ) && engine.IsStorageSupported( outputType );
+    std::cout << "  " << name << ( native ? "" : " (host conversion)" ) << "\n";
+
+    auto spanSeconds = MedianSeconds( runs, [&](){ engine.Compute<In, Out>( input, output ); } );
+    Report( "span ", elements, bytes, spanSeconds, reference.first != 0.0 ? reference.first : spanSeconds, Matches( output, expected ) );
+
+    if( !native )
+        return { spanSeconds, 0.0 };
+
+    auto inputRange = engine.AllocateBuffer( elements * sizeof(In), BufferIntent::eDeviceLocal );
+    auto outputRange = engine.AllocateBuffer( elements * sizeof(Out), BufferIntent::eDeviceLocal );
+    engine.Upload( inputRange, 0, input.data(), elements * sizeof(In) );
+    engine.FlushTransfers();
+
+    auto rangeSeconds = MedianSeconds( runs, [&](){ engine.Compute( inputRange, inputType, outputRange, outputType ); } );
+    std::fill( output.begin(), output.end(), Out{} );
+    engine.Download( outputRange, 0, output.data(), elements * sizeof(Out) );
+    engine.FlushTransfers();
+    Report( "range", elements, bytes, rangeSeconds, reference.second != 0.0 ? reference.second : rangeSeconds, Matches( output, expected ) );
+
+    engine.FreeBuffer( inputRange );
+    engine.FreeBuffer( outputRange );
+    return { spanSeconds, rangeSeconds };
+}
+
+} // namespace
+
+int main( int argc, char** argv )
+{
+    size_t elements = argc > 1 ? std::strtoull( argv[1], nullptr, 10 ) : size_t(1) << 25;
+    size_t runs = argc > 2 ? std::strtoull( argv[2], nullptr, 10 ) : 10;
+    if( elements == 0 || runs == 0 )
+    {
+        std::cerr << "Usage: narrow-bench-exec [elements] [runs]\n";
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        Engine engine;
+        if( engine.HasGpu() )
+            engine.SetBackend( Backend::eGpu );
+
+        std::cout << "device     : " << engine.GetDeviceName() << "\n";
+        std::cout << "storage    : 8-bit " << ( engine.IsStorageSupported( StorageType::eUint8 ) ? "yes" : "no" )
+                  << ", 16-bit " << ( engine.IsStorageSupported( StorageType::eFloat16 ) ? "yes" : "no" ) << "\n";
+        std::cout << "conversion : " << GetConversionIsaName() << "\n";
+        std::cout << "elements   : " << elements << " (" << runs << " runs, median)\n";
+
+        std::vector<float> expected( elements );
+        for( size_t i = 0; i < elements; ++i )
+            expected[i] = static_cast<float>( i % kValueRange ) * ComputeGraph::kDefaultScale;
+
+        auto reference = Run<uint32_t, float>( engine, "uint32 -> float32", elements, runs, expected, {} );
+        Run<uint16_t, float>( engine, "uint16 -> float32", elements, runs, expected, reference );
+        Run<uint8_t, float>( engine, "uint8  -> float32", elements, runs, expected, reference );
+        Run<uint32_t, Float16>( engine, "uint32 -> float16", elements, runs, expected, reference );
+        Run<uint16_t, Float16>( engine, "uint16 -> float16", elements, runs, expected, reference );
+        Run<uint8_t, Float16>( engine, "uint8  -> float16", elements, runs, expected, reference );
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
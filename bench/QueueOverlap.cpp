@@ -0,0 +1,114 @@
+#include "Engine.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <vector>
+
+/// Streaming chunks through upload and compute
+///
+///   - "serial"  : upload a chunk, flush, compute it, then the next one
+///   - "overlap" : the job of a chunk is submitted with SubmitAsync(), the next chunk is uploaded
+///                 while it runs (two inputs in turn)
+///
+/// On a device with a transfer-only queue family, the uploads of "overlap" run on the copy engine
+/// beside the dispatches, without one the two columns should be close.
+///
+/// Usage: queue-bench-exec [chunks] [runs]
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+template<typename Job>
+double MedianSeconds( size_t runs, Job&& job )
+{
+    std::vector<double> seconds( runs );
+    for( auto& s : seconds )
+    {
+        auto start = Clock::now();
+        job();
+        s = std::chrono::duration<double>( Clock::now() - start ).count();
+    }
+    std::nth_element( seconds.begin(), seconds.begin() + seconds.size() / 2, seconds.end() );
+    return seconds[seconds.size() / 2];
+}
+
+} // namespace
+
+int main( int argc, char** argv )
+{
+    size_t chunkCount = argc > 1 ? std::strtoull( argv[1], nullptr, 10 ) : 16;
+    size_t runs = argc > 2 ? std::strtoull( argv[2], nullptr, 10 ) : 5;
+    if( chunkCount == 0 || runs == 0 )
+    {
+        std::cerr << "Usage: queue-bench-exec [chunks] [runs]\n";
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        Engine engine;
+        engine.SetBackend( Backend::eGpu );
+
+        for( size_t count = size_t(1) << 16; count <= size_t(1) << 24; count *= 16 )
+        {
+            auto bytes = count * sizeof(uint32_t);
+            std::vector<uint32_t> input( count, 1 );
+
+            BufferRange inputs[2];
+            BufferRange outputs[2];
+            for( size_t i = 0; i < 2; ++i )
+            {
+                inputs[i] = engine.AllocateBuffer( bytes, BufferIntent::eDeviceLocal );
+                outputs[i] = engine.AllocateBuffer( bytes, BufferIntent::eDeviceLocal );
+            }
+
+            auto serial = MedianSeconds( runs, [&](){
+                for( size_t c = 0; c < chunkCount; ++c )
+                {
+                    engine.Upload( inputs[c % 2], 0, input.data(), bytes );
+                    engine.FlushTransfers();
+                    engine.Compute( inputs[c % 2], outputs[c % 2] );
+                }
+            } );
+
+            auto overlap = MedianSeconds( runs, [&](){
+                engine.Upload( inputs[0], 0, input.data(), bytes );
+                engine.FlushTransfers();
+                for( size_t c = 0; c < chunkCount; ++c )
+                {
+                    auto job = engine.SubmitAsync( inputs[c % 2], outputs[c % 2] );
+                    if( c + 1 < chunkCount )
+                    {
+                        // The other input was read by the previous job, which is done
+                        engine.Upload( inputs[( c + 1 ) % 2], 0, input.data(), bytes );
+                        engine.FlushTransfers();
+                    }
+                    job.get();
+                }
+            } );
+
+            auto megabytes = static_cast<double>( bytes * chunkCount ) / ( 1 << 20 );
+            std::cout << "elements " << count << ", " << chunkCount << " chunks\n";
+            std::cout << "  serial  : " << serial * 1e3 << " ms (" << megabytes / serial << " MiB/s)\n";
+            std::cout << "  overlap : " << overlap * 1e3 << " ms (" << megabytes / overlap << " MiB/s)\n";
+
+            for( size_t i = 0; i < 2; ++i )
+            {
+                engine.FreeBuffer( inputs[i] );
+                engine.FreeBuffer( outputs[i] );
+            }
+        }
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
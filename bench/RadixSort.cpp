@@ -0,0 +1,182 @@
+#include "Engine.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <vector>
+
+/// Engine::Sort() and Engine::SortByKey() against std::sort on the host
+///
+///   - "std::sort"     : one thread
+///   - "parallel sort" : std::sort of one chunk per thread of a ThreadPool, then pairwise
+///                       std::inplace_merge (the parallel std::sort of libstdc++ needs TBB)
+///   - "engine"        : uint32 keys already in engine memory (device-local), upload excluded
+///   - "engine pairs"  : the same with a uint32 value for every key
+///
+/// Every engine result is checked against the host (the pairs against std::stable_sort, the
+/// radix sort is stable). Sizes go from min to max (1M to 256M keys by default), times 4. A last
+/// sort runs on a size that is not a multiple of the storage buffer alignment, over the padding of
+/// a freed range full of zeros: none of them may be sorted in.
+///
+/// Usage: sort-bench-exec [min] [max] [runs]
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+void ParallelSort( ThreadPool& threadPool, std::vector<uint32_t>& keys )
+{
+    auto chunkCount = std::max<size_t>( threadPool.GetThreadCount(), 1 );
+    auto chunkSize = ( keys.size() + chunkCount - 1 ) / chunkCount;
+    auto bound = [&]( size_t chunk ){ return keys.begin() + std::min( chunk * chunkSize, keys.size() ); };
+
+    std::vector<std::future<void>> tasks;
+    for( size_t chunk = 0; chunk < chunkCount; ++chunk )
+        tasks.push_back( threadPool.Enqueue( [&, chunk](){ std::sort( bound( chunk ), bound( chunk + 1 ) ); } ) );
+    for( auto& task : tasks )
+        task.get();
+
+    // Merging neighbour runs, twice as long every round
+    for( size_t width = 1; width < chunkCount; width *= 2 )
+    {
+        tasks.clear();
+        for( size_t chunk = 0; chunk + width < chunkCount; chunk += width * 2 )
+        {
+            tasks.push_back( threadPool.Enqueue( [&, chunk, width](){
+                std::inplace_merge( bound( chunk ), bound( chunk + width ), bound( std::min( chunk + width * 2, chunkCount ) ) );
+            } ) );
+        }
+        for( auto& task : tasks )
+            task.get();
+    }
+}
+
+/// Median of the runs, prepare() is not timed
+template<typename Prepare, typename Job>
+double MedianSeconds( size_t runs, Prepare&& prepare, Job&& job )
+{
+    std::vector<double> seconds( runs );
+    for( auto& s : seconds )
+    {
+        prepare();
+        auto start = Clock::now();
+        job();
+        s = std::chrono::duration<double>( Clock::now() - start ).count();
+    }
+    std::nth_element( seconds.begin(), seconds.begin() + seconds.size() / 2, seconds.end() );
+    return seconds[seconds.size() / 2];
+}
+
+void Report( const char* name, size_t keys, double seconds, bool match = true )
+{
+    std::cout << "  " << name << ": " << seconds * 1e3 << " ms (" << static_cast<double>( keys ) / seconds * 1e-6 << " Mkeys/s)"
+              << ( match ? "" : "  MISMATCH" ) << "\n";
+}
+
+/// Sort of kOddCount keys, after a range of kOddCount + 24 zeros was freed
+bool CheckOddSize( Engine& engine, std::mt19937& random )
+{
+    constexpr size_t kOddCount = 1000;
+    std::vector<uint32_t> stale( kOddCount + 24, 0u );
+    auto staleRange = engine.AllocateBuffer( stale.size() * sizeof(uint32_t), BufferIntent::eDeviceLocal );
+    engine.Upload( staleRange, 0, stale.data(), stale.size() * sizeof(uint32_t) );
+    engine.FlushTransfers();
+    engine.FreeBuffer( staleRange );
+
+    std::vector<uint32_t> keys( kOddCount );
+    std::generate( keys.begin(), keys.end(), [&random](){ return static_cast<uint32_t>( random() ) | 1u; } );
+    auto keyRange = engine.AllocateBuffer( kOddCount * sizeof(uint32_t), BufferIntent::eDeviceLocal );
+    engine.Upload( keyRange, 0, keys.data(), kOddCount * sizeof(uint32_t) );
+    engine.FlushTransfers();
+
+    engine.Sort<uint32_t>( keyRange );
+    std::vector<uint32_t> sorted( kOddCount );
+    engine.Download( keyRange, 0, sorted.data(), kOddCount * sizeof(uint32_t) );
+    engine.FlushTransfers();
+    engine.FreeBuffer( keyRange );
+
+    std::sort( keys.begin(), keys.end() );
+    return sorted == keys;
+}
+
+} // namespace
+
+int main( int argc, char** argv )
+{
+    size_t minKeys = argc > 1 ? std::strtoull( argv[1], nullptr, 10 ) : size_t(1) << 20;
+    size_t maxKeys = argc > 2 ? std::strtoull( argv[2], nullptr, 10 ) : size_t(256) << 20;
+    size_t runs = argc > 3 ? std::strtoull( argv[3], nullptr, 10 ) : 5;
+    if( minKeys == 0 || minKeys > maxKeys || runs == 0 )
+    {
+        std::cerr << "Usage: sort-bench-exec [min] [max] [runs]\n";
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        Engine engine;
+        ThreadPool threadPool;
+        std::mt19937 random( 42 );
+
+        for( size_t count = minKeys; count <= maxKeys; count *= 4 )
+        {
+            std::vector<uint32_t> input( count );
+            std::generate( input.begin(), input.end(), [&random](){ return static_cast<uint32_t>( random() ); } );
+            std::vector<uint32_t> keys;
+            std::cout << "keys " << count << "\n";
+
+            auto reset = [&](){ keys = input; };
+            Report( "std::sort", count, MedianSeconds( runs, reset, [&](){ std::sort( keys.begin(), keys.end() ); } ) );
+            Report( "parallel sort", count, MedianSeconds( runs, reset, [&](){ ParallelSort( threadPool, keys ); } ) );
+            auto expected = keys;
+
+            auto bytes = count * sizeof(uint32_t);
+            auto keyRange = engine.AllocateBuffer( bytes, BufferIntent::eDeviceLocal );
+            auto valueRange = engine.AllocateBuffer( bytes, BufferIntent::eDeviceLocal );
+            std::vector<uint32_t> indices( count );
+            std::iota( indices.begin(), indices.end(), 0 );
+
+            auto upload = [&]( bool values ){
+                engine.Upload( keyRange, 0, input.data(), bytes );
+                if( values )
+                    engine.Upload( valueRange, 0, indices.data(), bytes );
+                engine.FlushTransfers();
+            };
+
+            {
+                auto seconds = MedianSeconds( runs, [&](){ upload( false ); }, [&](){ engine.Sort<uint32_t>( keyRange ); } );
+                engine.Download( keyRange, 0, keys.data(), bytes );
+                engine.FlushTransfers();
+                Report( "engine", count, seconds, keys == expected );
+            }
+            {
+                auto seconds = MedianSeconds( runs, [&](){ upload( true ); }, [&](){ engine.SortByKey<uint32_t>( keyRange, valueRange ); } );
+                std::vector<uint32_t> values( count );
+                engine.Download( valueRange, 0, values.data(), bytes );
+                engine.FlushTransfers();
+
+                // Stable: equal keys keep the order of their indices
+                std::vector<uint32_t> expectedValues( indices );
+                std::stable_sort( expectedValues.begin(), expectedValues.end(), [&]( uint32_t a, uint32_t b ){ return input[a] < input[b]; } );
+                Report( "engine pairs", count, seconds, values == expectedValues );
+            }
+
+            engine.FreeBuffer( keyRange );
+            engine.FreeBuffer( valueRange );
+        }
+
+        std::cout << "odd size (1000 keys): " << ( CheckOddSize( engine, random ) ? "ok" : "MISMATCH" ) << "\n";
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
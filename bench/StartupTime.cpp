@@ -0,0 +1,51 @@
+#include "Engine.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+/// Engine start-up time with a cold pipeline cache (no file) and a warm one (saved by the previous engine)
+
+namespace
+{
+
+void Print( const char* name, const StartupStats& stats )
+{
+    std::cout << name << ": engine " << stats.seconds * 1e3 << " ms, pipeline " << stats.pipelineSeconds * 1e3
+              << " ms (cache " << ( stats.warmPipelineCache ? "warm" : "cold" ) << "), shaders: "
+              << stats.shaderCache.compilations << " compiled, " << stats.shaderCache.diskHits << " from disk, "
+              << stats.shaderCache.memoryHits << " from memory\n";
+}
+
+} // namespace
+
+int main()
+{
+    try
+    {
+        std::string cachePath;
+        {
+            Engine engine;
+            cachePath = engine.GetPipelineCachePath();
+        }
+
+        // The engine above saved the cache when it was destroyed
+        std::remove( cachePath.c_str() );
+        {
+            Engine engine;
+            Print( "cold", engine.GetStartupStats() );
+        }
+        {
+            Engine engine;
+            Print( "warm", engine.GetStartupStats() );
+        }
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
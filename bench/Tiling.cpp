@@ -0,0 +1,83 @@
+#include "Engine.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+/// Cost of splitting Compute( span, span ) into tiles
+///
+/// The same job with the tiles capped from the whole job down to 1/64 of it (SetMaxTileSize()),
+/// then with the tiles from the memory budget alone. Every output has to match the untiled one.
+///
+/// Usage: tile-bench-exec [megabytes] [runs]
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+template<typename Job>
+double MedianSeconds( size_t runs, Job&& job )
+{
+    std::vector<double> seconds( runs );
+    for( auto& s : seconds )
+    {
+        auto start = Clock::now();
+        job();
+        s = std::chrono::duration<double>( Clock::now() - start ).count();
+    }
+    std::nth_element( seconds.begin(), seconds.begin() + seconds.size() / 2, seconds.end() );
+    return seconds[seconds.size() / 2];
+}
+
+} // namespace
+
+int main( int argc, char** argv )
+{
+    size_t megabytes = argc > 1 ? std::strtoull( argv[1], nullptr, 10 ) : 512;
+    size_t runs = argc > 2 ? std::strtoull( argv[2], nullptr, 10 ) : 5;
+    if( megabytes == 0 || runs == 0 )
+    {
+        std::cerr << "Usage: tile-bench-exec [megabytes] [runs]\n";
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        Engine engine;
+        engine.SetBackend( Backend::eGpu );
+
+        auto count = ( megabytes << 20 ) / sizeof(uint32_t);
+        std::vector<uint32_t> input( count );
+        for( size_t i = 0; i < count; ++i )
+            input[i] = static_cast<uint32_t>( i % 1021 );
+        std::vector<float> expected( count );
+        std::vector<float> output( count );
+
+        auto budget = engine.GetMemoryBudget();
+        std::cout << "heap: " << budget.usage / ( 1 << 20 ) << " MiB used of a " << budget.budget / ( 1 << 20 ) << " MiB budget\n";
+        std::cout << "elements " << count << "\n";
+
+        for( size_t split = 1; split <= 64; split *= 4 )
+        {
+            engine.SetMaxTileSize( ( count + split - 1 ) / split );
+            auto& result = split == 1 ? expected : output;
+            auto seconds = MedianSeconds( runs, [&](){ engine.Compute( input, result ); } );
+            bool match = split == 1 || output == expected;
+            std::cout << "  " << split << " tile(s) : " << seconds * 1e3 << " ms" << ( match ? "" : "  MISMATCH" ) << "\n";
+        }
+
+        engine.SetMaxTileSize( 0 );
+        auto seconds = MedianSeconds( runs, [&](){ engine.Compute( input, output ); } );
+        std::cout << "  budget    : " << seconds * 1e3 << " ms" << ( output == expected ? "" : "  MISMATCH" ) << "\n";
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,150 @@
+#include "BinaryFile.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+
+std::runtime_error FileError( const char* what, const std::string& path )
+{
+    return std::runtime_error( std::string(what) + " " + path + ": " + std::strerror( errno ) );
+}
+
+} // namespace
+
+BinaryFile::BinaryFile()
+    :
+    m_fd( -1 ),
+    m_size( 0 )
+{
+}
+
+BinaryFile::BinaryFile( const std::string& path, Mode mode )
+    :
+    m_fd( -1 ),
+    m_size( 0 ),
+    m_path( path )
+{
+    if( mode == Mode::eRead )
+        m_fd = ::open( path.c_str(), O_RDONLY | O_CLOEXEC );
+    else
+        m_fd = ::open( path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644 );
+    if( m_fd < 0 )
+        throw FileError( "Cannot open", path );
+
+    struct stat status{};
+    if( ::fstat( m_fd, &status ) != 0 )
+    {
+        auto error = FileError( "Cannot stat", path );
+        this->Close();
+        throw error;
+    }
+    m_size = static_cast<size_t>( status.st_size );
+
+    // Read once from the start to the end: a larger read-ahead, and the pages can go early
+    if( mode == Mode::eRead )
+        ::posix_fadvise( m_fd, 0, 0, POSIX_FADV_SEQUENTIAL );
+}
+
+BinaryFile::~BinaryFile()
+{
+    this->Close();
+}
+
+BinaryFile::BinaryFile( BinaryFile&& other ) noexcept
+    :
+    m_fd( std::exchange( other.m_fd, -1 ) ),
+    m_size( std::exchange( other.m_size, 0 ) ),
+    m_path( std::move( other.m_path ) )
+{
+}
+
+BinaryFile& BinaryFile::operator=( BinaryFile&& other ) noexcept
+{
+    if( this != &other )
+    {
+        this->Close();
+        m_fd = std::exchange( other.m_fd, -1 );
+        m_size = std::exchange( other.m_size, 0 );
+        m_path = std::move( other.m_path );
+    }
+    return *this;
+}
+
+size_t BinaryFile::GetSize() const
+{
+    return m_size;
+}
+
+const std::string& BinaryFile::GetPath() const
+{
+    return m_path;
+}
+
+bool BinaryFile::IsSameFile( const BinaryFile& other ) const
+{
+    struct stat status{};
+    struct stat otherStatus{};
+    if( ::fstat( m_fd, &status ) != 0 )
+        throw FileError( "Cannot stat", m_path );
+    if( ::fstat( other.m_fd, &otherStatus ) != 0 )
+        throw FileError( "Cannot stat", other.m_path );
+    return status.st_dev == otherStatus.st_dev && status.st_ino == otherStatus.st_ino;
+}
+
+void BinaryFile::Read( size_t offset, void* data, size_t size ) const
+{
+    auto* pBytes = static_cast<char*>( data );
+    while( size != 0 )
+    {
+        auto count = ::pread( m_fd, pBytes, size, static_cast<off_t>( offset ) );
+        if( count < 0 && errno == EINTR )
+            continue;
+        if( count < 0 )
+            throw FileError( "Cannot read", m_path );
+        if( count == 0 )
+            throw std::runtime_error("Unexpected end of file " + m_path);
+
+        pBytes += count;
+        offset += static_cast<size_t>( count );
+        size -= static_cast<size_t>( count );
+    }
+}
+
+void BinaryFile::Write( size_t offset, const void* data, size_t size ) const
+{
+    const auto* pBytes = static_cast<const char*>( data );
+    while( size != 0 )
+    {
+        auto count = ::pwrite( m_fd, pBytes, size, static_cast<off_t>( offset ) );
+        if( count < 0 && errno == EINTR )
+            continue;
+        if( count < 0 )
+            throw FileError( "Cannot write", m_path );
+
+        pBytes += count;
+        offset += static_cast<size_t>( count );
+        size -= static_cast<size_t>( count );
+    }
+}
+
+void BinaryFile::Resize( size_t size )
+{
+    if( ::ftruncate( m_fd, static_cast<off_t>( size ) ) != 0 )
+        throw FileError( "Cannot resize", m_path );
+    m_size = size;
+}
+
+void BinaryFile::Close()
+{
+    if( m_fd >= 0 )
+        ::close( m_fd );
+    m_fd = -1;
+}
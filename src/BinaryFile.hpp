@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/// A file of raw elements (no header, native byte order) read and written at explicit offsets with
+/// pread() and pwrite(), in blocks as large as the caller asks. The data goes straight between the
+/// page cache and the caller's memory (mapped engine buffers for Engine::ComputeFile()), so nothing
+/// of the file is kept on the heap and the memory in use does not grow with the file size.
+
+class BinaryFile
+{
+public:
+    enum class Mode
+    {
+        eRead,
+        eWrite,     // Created, or opened as is: Resize() sets its size
+    };
+
+public:
+    BinaryFile();
+    BinaryFile( const std::string& path, Mode mode );
+    ~BinaryFile();
+
+    BinaryFile( BinaryFile&& other ) noexcept;
+    BinaryFile& operator=( BinaryFile&& other ) noexcept;
+    BinaryFile( const BinaryFile& ) = delete;
+    BinaryFile& operator=( const BinaryFile& ) = delete;
+
+    size_t GetSize() const;
+    const std::string& GetPath() const;
+    bool IsSameFile( const BinaryFile& other ) const;   // Same device and inode, whatever the paths
+
+    /// The whole size or an exception, short reads and interrupted calls are retried
+    void Read( size_t offset, void* data, size_t size ) const;
+    void Write( size_t offset, const void* data, size_t size ) const;
+
+    /// Sets the size of the file up front (written files), so that the blocks can land in any order
+    void Resize( size_t size );
+
+private:
+    void Close();
+
+private:
+    int         m_fd;
+    size_t      m_size;
+    std::string m_path;
+};
@@ -1,5 +1,7 @@
 #include "Buffer.hpp"
 
+#include <stdexcept>
+
 Buffer::Buffer()
     :
     m_hasBeenInitialized( false )
@@ -9,28 +11,185 @@ Buffer::Buffer()
 Buffer::Buffer( vma::Allocator allocator, size_t allocSize, vk::BufferUsageFlags bufferUsageFlag, vma::MemoryUsage memoryUsage )
     :
     m_allocator( allocator ),
-    m_hasBeenInitialized( false )
+    m_hasBeenInitialized( false ),
+    m_size( allocSize )
+{
+    auto allocInfo = vma::AllocationCreateInfo{};
+    allocInfo.setUsage( memoryUsage );
+
+    this->Create( bufferUsageFlag, allocInfo );
+}
+
+Buffer::Buffer( vma::Allocator allocator, size_t allocSize, vk::BufferUsageFlags bufferUsageFlag, BufferIntent intent, const std::vector<uint32_t>& queueFamilies )
+    :
+    m_allocator( allocator ),
+    m_hasBeenInitialized( false ),
+    m_size( allocSize )
+{
+    auto allocInfo = vma::AllocationCreateInfo{};
+    switch( intent )
+    {
+    case BufferIntent::eDeviceLocal:
+        allocInfo.setUsage( vma::MemoryUsage::eGpuOnly );
+        break;
+    case BufferIntent::eUpload:
+        // Write-combined is fine, the CPU only writes it sequentially
+        allocInfo.setUsage( vma::MemoryUsage::eCpuToGpu );
+        allocInfo.setFlags( vma::AllocationCreateFlagBits::eMapped );
+        break;
+    case BufferIntent::eReadback:
+        // Reading write-combined (uncached) memory from the CPU is very slow, so cached is preferred
+        allocInfo.setUsage( vma::MemoryUsage::eGpuToCpu );
+        allocInfo.setPreferredFlags( vk::MemoryPropertyFlagBits::eHostCached );
+        allocInfo.setFlags( vma::AllocationCreateFlagBits::eMapped );
+        break;
+    }
+
+    this->Create( bufferUsageFlag, allocInfo, queueFamilies );
+}
+
+void Buffer::Create( vk::BufferUsageFlags bufferUsageFlag, const vma::AllocationCreateInfo& allocInfo, const std::vector<uint32_t>& queueFamilies )
 {
     auto bufferInfo = vk::BufferCreateInfo{};
-    bufferInfo.setSize( allocSize );
+    bufferInfo.setSize( m_size );
     bufferInfo.setUsage( bufferUsageFlag );
     bufferInfo.setSharingMode( vk::SharingMode::eExclusive );
+    if( queueFamilies.size() > 1 )
+    {
+        bufferInfo.setSharingMode( vk::SharingMode::eConcurrent );
+        bufferInfo.setQueueFamilyIndices( queueFamilies );
+    }
 
-    auto allocInfo = vma::AllocationCreateInfo{};
-    allocInfo.setUsage( memoryUsage );
-
-    auto tmp = allocator.createBuffer( bufferInfo, allocInfo );
+    auto tmp = m_allocator.createBuffer( bufferInfo, allocInfo );
     m_buffer = tmp.first;
     m_allocation = tmp.second;
 
+    // Mapped once for the whole lifetime of the allocation
+    if( allocInfo.flags & vma::AllocationCreateFlagBits::eMapped )
+        m_pMapped = m_allocator.getAllocationInfo( m_allocation ).pMappedData;
+
+    // Constant for the whole lifetime of the buffer too, the kernels get it through push constants
+    if( bufferUsageFlag & vk::BufferUsageFlagBits::eShaderDeviceAddress )
+        m_address = m_allocator.getAllocatorInfo().device.getBufferAddress( vk::BufferDeviceAddressInfo{ m_buffer } );
+
     m_hasBeenInitialized = true;
 }
 
-void Buffer::DelQueueRegistered( DeletionQueue& delQueue )
+Buffer Buffer::ImportHostMemory( vk::Device device, vk::PhysicalDevice physicalDevice, void* hostPointer, size_t allocSize, vk::BufferUsageFlags bufferUsageFlag )
+{
+    /// Memory types that can import the pointer
+    auto getHostPointerProperties = reinterpret_cast<PFN_vkGetMemoryHostPointerPropertiesEXT>(
+        vkGetDeviceProcAddr( static_cast<VkDevice>( device ), "vkGetMemoryHostPointerPropertiesEXT" )
+    );
+    if( getHostPointerProperties == nullptr )
+        throw std::runtime_error("VK_EXT_external_memory_host is not enabled");
+
+    VkMemoryHostPointerPropertiesEXT hostPointerProps {};
+    hostPointerProps.sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT;
+    auto result = getHostPointerProperties(
+        static_cast<VkDevice>( device ), VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT, hostPointer, &hostPointerProps
+    );
+    if( result != VK_SUCCESS )
+        throw std::runtime_error("Failed to get the properties of host pointer");
+
+    /// Buffer that can be bound to host allocation
+    auto externalInfo = vk::ExternalMemoryBufferCreateInfo{};
+    externalInfo.setHandleTypes( vk::ExternalMemoryHandleTypeFlagBits::eHostAllocationEXT );
+
+    auto bufferInfo = vk::BufferCreateInfo{};
+    bufferInfo.setPNext( &externalInfo );
+    bufferInfo.setSize( allocSize );
+    bufferInfo.setUsage( bufferUsageFlag );
+    bufferInfo.setSharingMode( vk::SharingMode::eExclusive );
+
+    Buffer buffer;
+    buffer.m_device = device;
+    buffer.m_size = allocSize;
+    buffer.m_buffer = device.createBuffer( bufferInfo );
+
+    /// Coherent memory only, imported memory is never mapped by us so it could not be flushed/invalidated
+    auto requirements = device.getBufferMemoryRequirements( buffer.m_buffer );
+    auto memoryProps = physicalDevice.getMemoryProperties();
+    auto typeBits = requirements.memoryTypeBits & hostPointerProps.memoryTypeBits;
+    uint32_t memoryType = UINT32_MAX;
+    for( uint32_t i = 0; i < memoryProps.memoryTypeCount; ++i )
+    {
+        if( ( typeBits & ( 1u << i ) ) &&
+            ( memoryProps.memoryTypes[i].propertyFlags & vk::MemoryPropertyFlagBits::eHostCoherent ) )
+        {
+            memoryType = i;
+            break;
+        }
+    }
+    if( memoryType == UINT32_MAX || requirements.size > allocSize )
+    {
+        device.destroyBuffer( buffer.m_buffer );
+        throw std::runtime_error("Host pointer can not be imported for this buffer");
+    }
+
+    auto importInfo = vk::ImportMemoryHostPointerInfoEXT{};
+    importInfo.setHandleType( vk::ExternalMemoryHandleTypeFlagBits::eHostAllocationEXT );
+    importInfo.setPHostPointer( hostPointer );
+
+    auto allocInfo = vk::MemoryAllocateInfo{};
+    allocInfo.setPNext( &importInfo );
+    allocInfo.setAllocationSize( allocSize );
+    allocInfo.setMemoryTypeIndex( memoryType );
+
+    try
+    {
+        buffer.m_importedMemory = device.allocateMemory( allocInfo );
+        device.bindBufferMemory( buffer.m_buffer, buffer.m_importedMemory, 0 );
+    }
+    catch( ... )
+    {
+        if( buffer.m_importedMemory )
+            device.freeMemory( buffer.m_importedMemory );
+        device.destroyBuffer( buffer.m_buffer );
+        throw;
+    }
+
+    buffer.m_hasBeenInitialized = true;
+    return buffer;
+}
+
+void Buffer::DelQueueRegistered( DeletionQueue& delQueue, uint64_t retireValue )
+{
+    if( !m_hasBeenInitialized )
+        return;
+
+    if( m_importedMemory )
+    {
+        delQueue.push( DestroyOp::eImportedBuffer, retireValue,
+                       static_cast<VkDevice>( m_device ), static_cast<VkBuffer>( m_buffer ), static_cast<VkDeviceMemory>( m_importedMemory ) );
+        return;
+    }
+
+    delQueue.push( DestroyOp::eBuffer, retireValue,
+                   static_cast<VmaAllocator>( m_allocator ), static_cast<VkBuffer>( m_buffer ), static_cast<VmaAllocation>( m_allocation ) );
+}
+
+void Buffer::Destroy()
 {
-    delQueue.pushFunction([altor=m_allocator, b=m_buffer, a=m_allocation](){
-        altor.destroyBuffer( b, a );
-    });
+    if( !m_hasBeenInitialized )
+        return;
+
+    if( m_importedMemory )
+    {
+        m_device.destroyBuffer( m_buffer );
+        m_device.freeMemory( m_importedMemory );
+        m_importedMemory = vk::DeviceMemory{};
+    }
+    else
+    {
+        m_allocator.destroyBuffer( m_buffer, m_allocation );
+    }
+    m_buffer = vk::Buffer{};
+    m_allocation = vma::Allocation{};
+    m_pMapped = nullptr;
+    m_address = 0;
+    m_size = 0;
+    m_hasBeenInitialized = false;
 }
 
 vk::Buffer Buffer::GetBuffer() const
@@ -41,4 +200,48 @@ vk::Buffer Buffer::GetBuffer() const
 vma::Allocation Buffer::GetAllocation() const
 {
     return m_allocation;
+}
+
+size_t Buffer::GetSize() const
+{
+    return m_size;
+}
+
+BufferRange Buffer::GetRange() const
+{
+    return this->GetRange( 0, m_size );
+}
+
+BufferRange Buffer::GetRange( size_t offset, size_t size ) const
+{
+    auto range = BufferRange{};
+    range.buffer = m_buffer;
+    range.allocation = m_allocation;
+    range.offset = offset;
+    range.size = size;
+    range.pMapped = m_pMapped ? static_cast<char*>( m_pMapped ) + offset : nullptr;
+    range.address = m_address ? m_address + offset : 0;
+    return range;
+}
+
+bool Buffer::IsMapped() const
+{
+    return m_pMapped != nullptr;
+}
+
+void* Buffer::GetMappedData() const
+{
+    if( m_pMapped == nullptr )
+        throw std::runtime_error("Buffer is not persistently mapped");
+    return m_pMapped;
+}
+
+void Buffer::Flush( size_t offset, size_t size ) const
+{
+    m_allocator.flushAllocation( m_allocation, offset, size );
+}
+
+void Buffer::Invalidate( size_t offset, size_t size ) const
+{
+    m_allocator.invalidateAllocation( m_allocation, offset, size );
 }
\ No newline at end of file
@@ -5,19 +5,74 @@
 #include "vulkan/vulkan.hpp"
 #include "DeletionQueue.hpp"
 
+#include <cstdint>
+#include <span>
+#include <vector>
+
 /// REMEMBER TO ALWAYS PUT THE BUFFER IN DELETION_QUEUE OBJECT
 
+/// What the buffer is for, it decides the memory type and the mapping
+enum class BufferIntent
+{
+    eDeviceLocal,   // Only touched by the GPU (not mappable)
+    eUpload,        // CPU writes, GPU reads (write-combined, persistently mapped)
+    eReadback,      // GPU writes, CPU reads (host cached, persistently mapped)
+};
+
+/// Part of a buffer, which is what a descriptor (and a copy) points to.
+/// The buffer is bound at the start of its allocation, so the offset is also the offset in the allocation.
+struct BufferRange
+{
+    vk::Buffer      buffer;
+    vma::Allocation allocation;
+    size_t          offset = 0;
+    size_t          size = 0;
+    void*           pMapped = nullptr;  // Already at offset, nullptr if the memory is not mapped
+    vk::DeviceAddress address = 0;      // Already at offset, 0 without eShaderDeviceAddress usage
+};
+
 class Buffer
 {
 public:
     Buffer();
     Buffer( vma::Allocator allocator, size_t allocSize, vk::BufferUsageFlags bufferUsageFlag, vma::MemoryUsage memoryUsage );
-    void DelQueueRegistered( DeletionQueue& delQueue );
+    /// With two queue families or more, the buffer is shared concurrently by their queues (no ownership transfer)
+    Buffer( vma::Allocator allocator, size_t allocSize, vk::BufferUsageFlags bufferUsageFlag, BufferIntent intent, const std::vector<uint32_t>& queueFamilies = {} );
+
+    /// Wrapping user memory with VK_EXT_external_memory_host, the GPU accesses it in place (zero copy).
+    /// Both hostPointer and allocSize have to be aligned to minImportedHostPointerAlignment.
+    static Buffer ImportHostMemory( vk::Device device, vk::PhysicalDevice physicalDevice, void* hostPointer, size_t allocSize, vk::BufferUsageFlags bufferUsageFlag );
+
+    void DelQueueRegistered( DeletionQueue& delQueue, uint64_t retireValue = 0 );  // Destroyed when that submission has completed
+    void Destroy();     // Only for buffer that is NOT registered to the deletion queue
     vk::Buffer GetBuffer() const;
     vma::Allocation GetAllocation() const;
+    size_t GetSize() const;
+    BufferRange GetRange() const;   // The whole buffer
+    BufferRange GetRange( size_t offset, size_t size ) const;
+
+public: // Persistent mapping (eUpload and eReadback)
+    bool IsMapped() const;
+    void* GetMappedData() const;
+    template<typename T>
+    std::span<T> GetSpan() const
+    {
+        return std::span<T>( static_cast<T*>( this->GetMappedData() ), m_size / sizeof(T) );
+    }
+    void Flush( size_t offset, size_t size ) const;         // After the CPU has written (no-op on coherent memory)
+    void Invalidate( size_t offset, size_t size ) const;    // Before the CPU reads (no-op on coherent memory)
+
+private:
+    void Create( vk::BufferUsageFlags bufferUsageFlag, const vma::AllocationCreateInfo& allocInfo, const std::vector<uint32_t>& queueFamilies = {} );
+
 private:
     vk::Buffer m_buffer;
     vma::Allocation m_allocation;
     bool m_hasBeenInitialized;
     vma::Allocator m_allocator;
+    size_t m_size = 0;
+    void* m_pMapped = nullptr;
+    vk::DeviceAddress m_address = 0;    // With eShaderDeviceAddress usage
+    vk::Device m_device;                // Only for imported host memory (not owned by VMA)
+    vk::DeviceMemory m_importedMemory;
 };
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include "BufferPool.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+
+size_t AlignUp( size_t size, size_t alignment )
+{
+    return ( size + alignment - 1 ) / alignment * alignment;
+}
+
+} // namespace
+
+BufferPool::BufferPool()
+    :
+    m_blockSize( 0 ),
+    m_intent( BufferIntent::eDeviceLocal ),
+    m_alignment( 1 )
+{
+}
+
+BufferPool::BufferPool( vma::Allocator allocator, size_t blockSize, vk::BufferUsageFlags bufferUsageFlag, BufferIntent intent, size_t alignment,
+                        const std::vector<uint32_t>& queueFamilies )
+    :
+    m_allocator( allocator ),
+    m_blockSize( blockSize ),
+    m_usage( bufferUsageFlag ),
+    m_intent( intent ),
+    m_alignment( alignment ),
+    m_queueFamilies( queueFamilies )
+{
+}
+
+void BufferPool::Destroy()
+{
+    for( auto& block : m_blocks )
+        block.buffer.Destroy();
+    m_blocks.clear();
+}
+
+BufferRange BufferPool::Allocate( size_t size )
+{
+    if( size == 0 )
+        throw std::runtime_error("Allocating an empty range");
+
+    // Every offset and free size stays aligned, so a descriptor can point to any range. The range
+    // itself has the size asked for: the element counts are taken from it.
+    auto alignedSize = AlignUp( size, m_alignment );
+
+    for( int attempt = 0; attempt < 2; ++attempt )
+    {
+        for( auto& block : m_blocks )
+        {
+            for( auto it = block.freeRanges.begin(); it != block.freeRanges.end(); ++it )
+            {
+                if( it->second < alignedSize )
+                    continue;
+
+                auto offset = it->first;
+                auto remaining = it->second - alignedSize;
+                block.freeRanges.erase( it );
+                if( remaining > 0 )
+                    block.freeRanges.emplace( offset + alignedSize, remaining );
+
+                return block.buffer.GetRange( offset, size );
+            }
+        }
+
+        // Nothing fits, an allocation bigger than a block gets its own block
+        this->AddBlock( std::max( m_blockSize, alignedSize ) );
+    }
+
+    throw std::runtime_error("Failed to allocate from buffer pool");
+}
+
+bool BufferPool::Free( const BufferRange& range )
+{
+    for( auto& block : m_blocks )
+    {
+        if( block.buffer.GetBuffer() != range.buffer )
+            continue;
+
+        auto& freeRanges = block.freeRanges;
+        auto it = freeRanges.emplace( range.offset, AlignUp( range.size, m_alignment ) ).first;    // With the padding of Allocate()
+
+        // Merging with the next free range
+        auto next = std::next( it );
+        if( next != freeRanges.end() && it->first + it->second == next->first )
+        {
+            it->second += next->second;
+            freeRanges.erase( next );
+        }
+
+        // Merging with the previous free range
+        if( it != freeRanges.begin() )
+        {
+            auto prev = std::prev( it );
+            if( prev->first + prev->second == it->first )
+            {
+                prev->second += it->second;
+                freeRanges.erase( it );
+            }
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+bool BufferPool::Owns( const BufferRange& range ) const
+{
+    for( const auto& block : m_blocks )
+    {
+        if( block.buffer.GetBuffer() == range.buffer )
+            return true;
+    }
+    return false;
+}
+
+size_t BufferPool::GetBlockCount() const
+{
+    return m_blocks.size();
+}
+
+bool BufferPool::IsInitialized() const
+{
+    return m_blockSize != 0;
+}
+
+void BufferPool::AddBlock( size_t size )
+{
+    auto block = Block{};
+    block.buffer = Buffer( m_allocator, size, m_usage, m_intent, m_queueFamilies );
+    block.freeRanges.emplace( 0, size );
+    m_blocks.push_back( std::move( block ) );
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Buffer.hpp"
+
+#include <map>
+#include <vector>
+
+/// Long-lived ranges carved out of a few big buffers (blocks), so creating a buffer does not
+/// cost a vkCreateBuffer/vkAllocateMemory and the allocation count stays far below
+/// maxMemoryAllocationCount. First-fit on a free-list, neighbour ranges are merged on free.
+/// A new block is only created when no block has room.
+
+class BufferPool
+{
+public:
+    BufferPool();
+    BufferPool( vma::Allocator allocator, size_t blockSize, vk::BufferUsageFlags bufferUsageFlag, BufferIntent intent, size_t alignment,
+                const std::vector<uint32_t>& queueFamilies = {} );  // Of the blocks, see Buffer
+    void Destroy();
+
+    BufferRange Allocate( size_t size );
+    bool Free( const BufferRange& range );  // false if the range is not from this pool
+    bool Owns( const BufferRange& range ) const;
+
+    size_t GetBlockCount() const;
+    bool IsInitialized() const;
+private:
+    struct Block
+    {
+        Buffer                      buffer;
+        std::map<size_t, size_t>    freeRanges;     // Offset -> size
+    };
+    void AddBlock( size_t size );
+
+private:
+    vma::Allocator          m_allocator;
+    size_t                  m_blockSize;
+    vk::BufferUsageFlags    m_usage;
+    BufferIntent            m_intent;
+    size_t                  m_alignment;
+    std::vector<uint32_t>   m_queueFamilies;
+    std::vector<Block>      m_blocks;
+};
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include "ComputeGraph.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+
+/// Memory that a stage touches (a null buffer for the transients, by id)
+struct Location
+{
+    vk::Buffer  buffer;
+    size_t      offset = 0;
+    size_t      size = 0;
+};
+
+bool Overlap( const Location& a, const Location& b )
+{
+    return a.buffer == b.buffer && a.offset < b.offset + b.size && b.offset < a.offset + a.size;
+}
+
+} // namespace
+
+ComputeGraph::BufferId ComputeGraph::AddBuffer( const BufferRange& range )
+{
+    if( !range.buffer || range.size == 0 )
+        throw std::runtime_error("Adding an empty buffer to a compute graph");
+
+    m_buffers.push_back( Resource{ range, false } );
+    return static_cast<BufferId>( m_buffers.size() - 1 );
+}
+
+ComputeGraph::BufferId ComputeGraph::AddTransient( size_t size )
+{
+    if( size == 0 )
+        throw std::runtime_error("Adding an empty buffer to a compute graph");
+
+    auto range = BufferRange{};
+    range.size = size;
+    m_buffers.push_back( Resource{ range, true } );
+    return static_cast<BufferId>( m_buffers.size() - 1 );
+}
+
+ComputeGraph::StageId ComputeGraph::AddStage( BufferId input, BufferId output, uint32_t elementCount )
+{
+    return this->AddStage( ShaderSource{}, input, output, elementCount );
+}
+
+ComputeGraph::StageId ComputeGraph::AddStage( const ShaderSource& kernel, BufferId input, BufferId output, uint32_t elementCount, std::optional<KernelConfig> config )
+{
+    this->CheckId( input );
+    this->CheckId( output );
+
+    m_stages.push_back( Stage{ kernel, config, input, output, this->StageCount( input, output, elementCount ), std::nullopt } );
+    return static_cast<StageId>( m_stages.size() - 1 );
+}
+
+ComputeGraph::StageId ComputeGraph::AddIndirectStage( BufferId input, BufferId output, BufferId dispatchArgs, uint32_t maxCount )
+{
+    return this->AddIndirectStage( ShaderSource{}, input, output, dispatchArgs, maxCount );
+}
+
+ComputeGraph::StageId ComputeGraph::AddIndirectStage( const ShaderSource& kernel, BufferId input, BufferId output, BufferId dispatchArgs, uint32_t maxCount, std::optional<KernelConfig> config )
+{
+    this->CheckId( input );
+    this->CheckId( output );
+    this->CheckId( dispatchArgs );
+
+    if( m_buffers[dispatchArgs].range.size < sizeof(DispatchArgs) )
+        throw std::runtime_error("Dispatch arguments are smaller than DispatchArgs");
+    if( dispatchArgs == input || dispatchArgs == output )
+        throw std::runtime_error("Dispatch arguments of a stage are also its input or output");
+    if( config && config->elementCount != 0 )
+        throw std::runtime_error("An indirect stage cannot be specialized for an element count");
+
+    m_stages.push_back( Stage{ kernel, config, input, output, this->StageCount( input, output, maxCount ), dispatchArgs } );
+    return static_cast<StageId>( m_stages.size() - 1 );
+}
+
+void ComputeGraph::SetScale( StageId stage, float scale )
+{
+    if( stage >= m_stages.size() )
+        throw std::runtime_error("Unknown stage of a compute graph");
+    m_stages[stage].scale = scale;
+}
+
+ComputeGraph::Plan ComputeGraph::Compile( size_t alignment ) const
+{
+    auto plan = Plan{};
+    plan.transientOffsets.assign( m_buffers.size(), 0 );
+
+    /// Waves: one after the last earlier stage that touches the same memory, and at least one of them
+    /// writes it. Transients are distinct memory here, the aliasing below never adds a dependency.
+    auto locate = [this]( BufferId id ){
+        const auto& resource = m_buffers[id];
+        if( resource.transient )
+            return Location{ vk::Buffer{}, id, 1 };     // By id
+        return Location{ resource.range.buffer, resource.range.offset, resource.range.size };
+    };
+
+    /// The dispatch arguments of an indirect stage are read (the count) and written (the group count)
+    auto conflict = [&]( const Stage& earlier, const Stage& later ){
+        std::vector<Location> earlierWrites{ locate( earlier.output ) };
+        std::vector<Location> laterWrites{ locate( later.output ) };
+        if( earlier.dispatchArgs )
+            earlierWrites.push_back( locate( *earlier.dispatchArgs ) );
+        if( later.dispatchArgs )
+            laterWrites.push_back( locate( *later.dispatchArgs ) );
+
+        for( const auto& earlierWrite : earlierWrites )
+        {
+            if( Overlap( earlierWrite, locate( later.input ) ) )
+                return true;
+            for( const auto& laterWrite : laterWrites )
+            {
+                if( Overlap( earlierWrite, laterWrite ) )
+                    return true;
+            }
+        }
+        for( const auto& laterWrite : laterWrites )
+        {
+            if( Overlap( locate( earlier.input ), laterWrite ) )
+                return true;
+        }
+        return false;
+    };
+
+    std::vector<uint32_t> waveOf( m_stages.size(), 0 );
+    std::vector<bool> written( m_buffers.size(), false );
+    for( uint32_t s = 0; s < m_stages.size(); ++s )
+    {
+        const auto& stage = m_stages[s];
+        if( m_buffers[stage.input].transient && !written[stage.input] )
+            throw std::runtime_error("A stage reads a transient buffer that no earlier stage writes");
+        if( stage.dispatchArgs && m_buffers[*stage.dispatchArgs].transient && !written[*stage.dispatchArgs] )
+            throw std::runtime_error("An indirect stage reads transient dispatch arguments that no earlier stage writes");
+        written[stage.output] = true;
+
+        for( uint32_t earlier = 0; earlier < s; ++earlier )
+        {
+            if( conflict( m_stages[earlier], stage ) )
+                waveOf[s] = std::max( waveOf[s], waveOf[earlier] + 1 );
+        }
+
+        if( waveOf[s] >= plan.waves.size() )
+            plan.waves.resize( waveOf[s] + 1 );
+        plan.waves[waveOf[s]].push_back( s );
+    }
+
+    /// First and last wave of every transient
+    constexpr auto kUnused = UINT32_MAX;
+    std::vector<uint32_t> firstWave( m_buffers.size(), kUnused );
+    std::vector<uint32_t> lastWave( m_buffers.size(), 0 );
+    for( uint32_t s = 0; s < m_stages.size(); ++s )
+    {
+        const auto& stage = m_stages[s];
+        for( auto id : { stage.input, stage.output, stage.dispatchArgs.value_or( stage.input ) } )
+        {
+            firstWave[id] = std::min( firstWave[id], waveOf[s] );
+            lastWave[id] = std::max( lastWave[id], waveOf[s] );
+        }
+    }
+
+    /// Aliasing, in the order of first wave: a transient takes the smallest region that is big enough and
+    /// whose last owner is done with it in an earlier wave (the barrier between the waves orders them),
+    /// else a new region at the end
+    struct Region
+    {
+        size_t      offset;
+        size_t      size;
+        uint32_t    lastWave;
+    };
+    std::vector<Region> regions;
+    std::vector<BufferId> transients;
+    for( BufferId id = 0; id < m_buffers.size(); ++id )
+    {
+        if( m_buffers[id].transient && firstWave[id] != kUnused )
+            transients.push_back( id );
+    }
+    std::stable_sort( transients.begin(), transients.end(), [&]( BufferId a, BufferId b ){ return firstWave[a] < firstWave[b]; } );
+
+    for( auto id : transients )
+    {
+        auto size = ( m_buffers[id].range.size + alignment - 1 ) / alignment * alignment;
+        Region* pBest = nullptr;
+        for( auto& region : regions )
+        {
+            if( region.lastWave < firstWave[id] && region.size >= size && ( !pBest || region.size < pBest->size ) )
+                pBest = &region;
+        }
+        if( !pBest )
+        {
+            regions.push_back( Region{ plan.transientSize, size, 0 } );
+            plan.transientSize += size;
+            pBest = &regions.back();
+        }
+
+        pBest->lastWave = lastWave[id];
+        plan.transientOffsets[id] = pBest->offset;
+    }
+
+    return plan;
+}
+
+const std::vector<ComputeGraph::Stage>& ComputeGraph::GetStages() const
+{
+    return m_stages;
+}
+
+bool ComputeGraph::IsTransient( BufferId id ) const
+{
+    this->CheckId( id );
+    return m_buffers[id].transient;
+}
+
+const BufferRange& ComputeGraph::GetBuffer( BufferId id ) const
+{
+    this->CheckId( id );
+    return m_buffers[id].range;
+}
+
+void ComputeGraph::CheckId( BufferId id ) const
+{
+    if( id >= m_buffers.size() )
+        throw std::runtime_error("Unknown buffer of a compute graph");
+}
+
+uint32_t ComputeGraph::StageCount( BufferId input, BufferId output, uint32_t elementCount ) const
+{
+    auto inputCount = m_buffers[input].range.size / sizeof(uint32_t);
+    auto outputCount = m_buffers[output].range.size / sizeof(float);
+
+    // The kernels do not know the size of their buffers: past them, they would touch other allocations
+    if( elementCount == 0 )
+    {
+        if( inputCount > UINT32_MAX )
+            throw std::runtime_error("Input is too large for a single compute job");
+        elementCount = static_cast<uint32_t>( inputCount );
+    }
+    else if( elementCount > inputCount )
+    {
+        throw std::runtime_error("Element count of a stage is larger than its input");
+    }
+    if( elementCount > outputCount )
+        throw std::runtime_error("Output is smaller than input");
+    return elementCount;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Buffer.hpp"
+#include "KernelParams.hpp"
+#include "ShaderCompiler.hpp"
+#include "TuningCache.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+/// Stages (kernel, input, output) that Engine::Execute() records into one command buffer and
+/// submits once, so a chain of kernels pays a single submission and wait.
+/// A kernel has the interface of shader.comp: binding 0 is the input, binding 1 the output,
+/// ComputeParams push constants and the KernelConfig specialization constants.
+///
+/// The element count of an indirect stage is only known on the GPU: an earlier stage writes it into
+/// the count of a DispatchArgs buffer (an atomic counter of a filter, say), the engine turns it into
+/// a group count and the stage runs with vkCmdDispatchIndirect, in the same submission. Its kernel is
+/// compiled with INDIRECT defined and reads the args at binding 2 (see shader.comp).
+///
+/// Stages are grouped into waves: a stage goes one wave after the last earlier stage it depends
+/// on (it reads what that stage writes, or writes what that stage reads or writes). The stages of
+/// a wave run concurrently, one barrier separates two waves. Transient buffers only exist during
+/// the execution, two transients that are not in use at the same time share memory.
+
+/// Mirrors the dispatch block of shader.comp with INDIRECT. The first three members are the
+/// VkDispatchIndirectCommand, written by the engine: a stage that computes the size of the next
+/// one only writes the count.
+struct DispatchArgs
+{
+    uint32_t groupCountX;
+    uint32_t groupCountY;
+    uint32_t groupCountZ;
+    uint32_t count;         // Elements of the indirect stage, clamped to its capacity
+};
+
+class ComputeGraph
+{
+public:
+    using BufferId = uint32_t;
+    using StageId = uint32_t;
+
+    static constexpr float kDefaultScale = ComputeParams::kDefaultScale;
+
+    struct Stage
+    {
+        ShaderSource                kernel;         // Empty path: shader.comp with the engine's kernel configuration
+        std::optional<KernelConfig> config;         // Empty: the default of the device
+        BufferId                    input;
+        BufferId                    output;
+        uint32_t                    elementCount;   // The capacity of an indirect stage
+        std::optional<BufferId>     dispatchArgs;   // Indirect stage: its DispatchArgs
+        float                       scale = kDefaultScale;
+    };
+
+    /// Order of the stages and place of the transients, from Compile()
+    struct Plan
+    {
+        std::vector<std::vector<uint32_t>>  waves;              // Stage indices, in declaration order within a wave
+        std::vector<size_t>                 transientOffsets;   // By buffer id (0 for non-transient), in the transient memory
+        size_t                              transientSize = 0;
+    };
+
+public:
+    BufferId AddBuffer( const BufferRange& range );     // Engine memory, it keeps its content after the execution
+    BufferId AddTransient( size_t size );               // Device memory that only the stages see
+
+    /// elementCount 0: the size of the input, in 4 bytes elements. The input and the output have to
+    /// hold that many elements (the capacity of an indirect stage), else the stage is rejected.
+    StageId AddStage( BufferId input, BufferId output, uint32_t elementCount = 0 );
+    StageId AddStage( const ShaderSource& kernel, BufferId input, BufferId output, uint32_t elementCount = 0, std::optional<KernelConfig> config = {} );
+
+    /// Runs over the count of dispatchArgs, that an earlier stage writes, at most maxCount elements
+    /// (0: the size of the input). The group count is written into dispatchArgs by the execution.
+    StageId AddIndirectStage( BufferId input, BufferId output, BufferId dispatchArgs, uint32_t maxCount = 0 );
+    StageId AddIndirectStage( const ShaderSource& kernel, BufferId input, BufferId output, BufferId dispatchArgs, uint32_t maxCount = 0, std::optional<KernelConfig> config = {} );
+
+    /// Push constant of the stage, changing it does not change the pipeline
+    void SetScale( StageId stage, float scale );
+
+    Plan Compile( size_t alignment ) const;
+
+    const std::vector<Stage>& GetStages() const;
+    bool IsTransient( BufferId id ) const;
+    const BufferRange& GetBuffer( BufferId id ) const;     // For a transient, only the size is set
+
+private:
+    struct Resource
+    {
+        BufferRange range;
+        bool        transient = false;
+    };
+    void CheckId( BufferId id ) const;
+    uint32_t StageCount( BufferId input, BufferId output, uint32_t elementCount ) const;     // elementCount, or the size of the input if 0 (within both buffers)
+
+private:
+    std::vector<Resource>   m_buffers;
+    std::vector<Stage>      m_stages;
+};
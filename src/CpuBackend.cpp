@@ -0,0 +1,153 @@
+#include "CpuBackend.hpp"
+#include "KernelParams.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+    #define CE_CPU_X86 1
+    #include <immintrin.h>
+#elif defined(__aarch64__)
+    #define CE_CPU_NEON 1
+    #include <arm_neon.h>
+#endif
+
+namespace
+{
+
+void ScaleScalar( const uint32_t* input, float* output, size_t count )
+{
+    for( size_t i = 0; i < count; ++i )
+        output[i] = static_cast<float>( input[i] ) * ComputeParams::kDefaultScale;
+}
+
+#if defined(CE_CPU_X86)
+
+__attribute__(( target("avx2") ))
+void ScaleAvx2( const uint32_t* input, float* output, size_t count )
+{
+    const auto scale = _mm256_set1_ps( ComputeParams::kDefaultScale );
+    const auto high = _mm256_set1_ps( 65536.0f );
+    const auto lowMask = _mm256_set1_epi32( 0xffff );
+
+    size_t i = 0;
+    for( ; i + 8 <= count; i += 8 )
+    {
+        // AVX2 only converts signed integers. Both 16 bits halves are exact in float, so the
+        // sum is rounded once, like a direct uint to float conversion.
+        auto value = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( input + i ) );
+        auto hi = _mm256_cvtepi32_ps( _mm256_srli_epi32( value, 16 ) );
+        auto lo = _mm256_cvtepi32_ps( _mm256_and_si256( value, lowMask ) );
+        auto converted = _mm256_add_ps( _mm256_mul_ps( hi, high ), lo );
+        _mm256_storeu_ps( output + i, _mm256_mul_ps( converted, scale ) );
+    }
+    ScaleScalar( input + i, output + i, count - i );
+}
+
+__attribute__(( target("avx512f") ))
+void ScaleAvx512( const uint32_t* input, float* output, size_t count )
+{
+    const auto scale = _mm512_set1_ps( ComputeParams::kDefaultScale );
+
+    size_t i = 0;
+    for( ; i + 16 <= count; i += 16 )
+    {
+        auto value = _mm512_loadu_si512( input + i );
+        _mm512_storeu_ps( output + i, _mm512_mul_ps( _mm512_cvtepu32_ps( value ), scale ) );
+    }
+
+    // Tail with a masked load and store instead of the scalar loop
+    if( i < count )
+    {
+        auto mask = static_cast<__mmask16>( ( 1u << ( count - i ) ) - 1 );
+        auto value = _mm512_maskz_loadu_epi32( mask, input + i );
+        _mm512_mask_storeu_ps( output + i, mask, _mm512_mul_ps( _mm512_cvtepu32_ps( value ), scale ) );
+    }
+}
+
+#elif defined(CE_CPU_NEON)
+
+void ScaleNeon( const uint32_t* input, float* output, size_t count )
+{
+    size_t i = 0;
+    for( ; i + 4 <= count; i += 4 )
+        vst1q_f32( output + i, vmulq_n_f32( vcvtq_f32_u32( vld1q_u32( input + i ) ), ComputeParams::kDefaultScale ) );
+    ScaleScalar( input + i, output + i, count - i );
+}
+
+#endif
+
+} // namespace
+
+CpuBackend::CpuBackend()
+    :
+    m_kernel( ScaleScalar ),
+    m_isaName( "scalar" )
+{
+#if defined(CE_CPU_X86)
+    if( __builtin_cpu_supports( "avx512f" ) )
+    {
+        m_kernel = ScaleAvx512;
+        m_isaName = "avx512";
+    }
+    else if( __builtin_cpu_supports( "avx2" ) )
+    {
+        m_kernel = ScaleAvx2;
+        m_isaName = "avx2";
+    }
+#elif defined(CE_CPU_NEON)
+    m_kernel = ScaleNeon;   // Always there on AArch64
+    m_isaName = "neon";
+#endif
+}
+
+void CpuBackend::Compute( std::span<const uint32_t> input, std::span<float> output )
+{
+    if( output.size() < input.size() )
+        throw std::runtime_error("Output is smaller than input");
+
+    auto count = input.size();
+    auto chunkCount = ( count + kChunkSize - 1 ) / kChunkSize;
+    if( chunkCount <= 1 )
+    {
+        m_kernel( input.data(), output.data(), count );     // Waking up a worker would cost more than the job
+        return;
+    }
+
+    std::atomic<size_t> nextChunk = 0;
+    auto work = [&]() {
+        for( auto chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++ )
+        {
+            auto first = chunk * kChunkSize;
+            m_kernel( input.data() + first, output.data() + first, std::min( kChunkSize, count - first ) );
+        }
+    };
+
+    /// The calling thread works too, the workers only help
+    auto& threadPool = this->GetThreadPool();
+    auto helperCount = std::min( threadPool.GetThreadCount(), chunkCount - 1 );
+    std::vector<std::future<void>> helpers;
+    helpers.reserve( helperCount );
+    for( size_t i = 0; i < helperCount; ++i )
+        helpers.push_back( threadPool.Enqueue( work ) );
+
+    work();
+    for( auto& helper : helpers )
+        helper.get();
+}
+
+const char* CpuBackend::GetIsaName() const
+{
+    return m_isaName;
+}
+
+ThreadPool& CpuBackend::GetThreadPool()
+{
+    std::lock_guard<std::mutex> lock( m_threadPoolMutex );
+    if( !m_pThreadPool )
+        m_pThreadPool = std::make_unique<ThreadPool>();
+    return *m_pThreadPool;
+}
\ No newline at end of file
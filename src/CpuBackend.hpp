@@ -0,0 +1,37 @@
+#pragma once
+
+#include "ThreadPool.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+
+/// The kernel of shader.comp on the CPU, as a vectorized loop (AVX-512, AVX2 or NEON, picked at
+/// runtime) spread over a thread pool. Workers take fixed-size chunks from a shared counter until
+/// none is left, so a slow worker does not hold the others back.
+/// Used when there is no Vulkan device, and for jobs too small to pay the submission latency.
+
+class CpuBackend
+{
+public:
+    static constexpr size_t kChunkSize = 64 << 10;  // Elements taken by a worker at once (fits in L2)
+
+public:
+    CpuBackend();
+
+    void Compute( std::span<const uint32_t> input, std::span<float> output );
+
+    const char* GetIsaName() const;     // Instruction set of the kernel: "avx512", "avx2", "neon" or "scalar"
+
+private:
+    ThreadPool& GetThreadPool();    // Created on the first job that has more than one chunk
+
+private:
+    using Kernel = void (*)( const uint32_t* input, float* output, size_t count );
+
+    Kernel                      m_kernel;
+    const char*                 m_isaName;
+    std::mutex                  m_threadPoolMutex;
+    std::unique_ptr<ThreadPool> m_pThreadPool;
+};
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "DeletionQueue.hpp"
+#include "BufferPool.hpp"
+
+namespace
+{
+
+template<typename T>
+T FromBits( uint64_t bits )
+{
+    if constexpr( std::is_pointer_v<T> )
+        return reinterpret_cast<T>( static_cast<uintptr_t>( bits ) );
+    else
+        return static_cast<T>( bits );
+}
+
+} // namespace
+
+void DeletionQueue::retire( uint64_t completedValue )
+{
+    // Keeping (and compacting) the entries that may still be used by the GPU
+    size_t kept = 0;
+    for( size_t i = 0; i < deletors.size(); ++i )
+    {
+        if( deletors[i].retireValue != kAtShutdown && deletors[i].retireValue <= completedValue )
+            Destroy( deletors[i] );
+        else
+            deletors[kept++] = deletors[i];
+    }
+    deletors.resize( kept );
+}
+
+void DeletionQueue::flush()
+{
+    for( auto it = deletors.rbegin(); it != deletors.rend(); ++it )
+    {
+        Destroy( *it );
+    }
+    deletors.clear();
+}
+
+void DeletionQueue::Destroy( const DeletionEntry& entry )
+{
+    const auto& h = entry.handles;
+    switch( entry.op )
+    {
+    case DestroyOp::eBuffer:
+        vmaDestroyBuffer( FromBits<VmaAllocator>( h[0] ), FromBits<VkBuffer>( h[1] ), FromBits<VmaAllocation>( h[2] ) );
+        break;
+    case DestroyOp::eImportedBuffer:
+        vkDestroyBuffer( FromBits<VkDevice>( h[0] ), FromBits<VkBuffer>( h[1] ), nullptr );
+        vkFreeMemory( FromBits<VkDevice>( h[0] ), FromBits<VkDeviceMemory>( h[2] ), nullptr );
+        break;
+    case DestroyOp::eBufferRange:
+    {
+        auto range = BufferRange{};
+        range.buffer = vk::Buffer( FromBits<VkBuffer>( h[1] ) );
+        range.offset = static_cast<size_t>( h[2] );
+        range.size = static_cast<size_t>( h[3] );
+        FromBits<BufferPool*>( h[0] )->Free( range );
+        break;
+    }
+    case DestroyOp::eDescriptorSet:
+    {
+        auto set = FromBits<VkDescriptorSet>( h[2] );
+        vkFreeDescriptorSets( FromBits<VkDevice>( h[0] ), FromBits<VkDescriptorPool>( h[1] ), 1, &set );
+        break;
+    }
+    case DestroyOp::ePipeline:
+        vkDestroyPipeline( FromBits<VkDevice>( h[0] ), FromBits<VkPipeline>( h[1] ), nullptr );
+        break;
+    case DestroyOp::ePipelineLayout:
+        vkDestroyPipelineLayout( FromBits<VkDevice>( h[0] ), FromBits<VkPipelineLayout>( h[1] ), nullptr );
+        break;
+    case DestroyOp::eDescriptorSetLayout:
+        vkDestroyDescriptorSetLayout( FromBits<VkDevice>( h[0] ), FromBits<VkDescriptorSetLayout>( h[1] ), nullptr );
+        break;
+    case DestroyOp::eShaderModule:
+        vkDestroyShaderModule( FromBits<VkDevice>( h[0] ), FromBits<VkShaderModule>( h[1] ), nullptr );
+        break;
+    case DestroyOp::eAllocator:
+        vmaDestroyAllocator( FromBits<VmaAllocator>( h[0] ) );
+        break;
+    case DestroyOp::eDebugMessenger:
+    {
+        auto instance = FromBits<VkInstance>( h[0] );
+        auto func = ( PFN_vkDestroyDebugUtilsMessengerEXT )vkGetInstanceProcAddr( instance, "vkDestroyDebugUtilsMessengerEXT" );
+        if( func != nullptr )
+            func( instance, FromBits<VkDebugUtilsMessengerEXT>( h[1] ), nullptr );
+        break;
+    }
+    }
+}
\ No newline at end of file
@@ -1,24 +1,71 @@
 #pragma once
 
-#include <functional>
-#include <deque>
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "vk_mem_alloc.h"
+
+/// What has to be called to destroy the entry, and which handles it carries
+enum class DestroyOp : uint8_t
+{
+    eBuffer,                // vmaDestroyBuffer( allocator, buffer, allocation )
+    eImportedBuffer,        // vkDestroyBuffer + vkFreeMemory( device, buffer, memory )
+    eBufferRange,           // BufferPool::Free( pool, buffer, offset, size )
+    eDescriptorSet,         // vkFreeDescriptorSets( device, descriptorPool, set )
+    ePipeline,              // vkDestroyPipeline( device, pipeline )
+    ePipelineLayout,        // vkDestroyPipelineLayout( device, layout )
+    eDescriptorSetLayout,   // vkDestroyDescriptorSetLayout( device, layout )
+    eShaderModule,          // vkDestroyShaderModule( device, module )
+    eAllocator,             // vmaDestroyAllocator( allocator )
+    eDebugMessenger,        // vkDestroyDebugUtilsMessengerEXT( instance, messenger )
+};
+
+/// Raw handles only, so queuing an entry does not allocate (once the queue reached its working size)
+struct DeletionEntry
+{
+    DestroyOp   op;
+    uint64_t    retireValue;    // Destroyed when the submission with this value has completed
+    uint64_t    handles[4];
+};
 
 class DeletionQueue
 {
 public:
-    void pushFunction( const std::function<void()>& function )
+    static constexpr uint64_t kAtShutdown = UINT64_MAX;     // Retire value of what lives as long as its owner: only flush() destroys it
+
+public:
+    /// Handles are the C handles (VkBuffer, VmaAllocation, ...), a pointer or an integer
+    template<typename... Handles>
+    void push( DestroyOp op, uint64_t retireValue, Handles... handles )
     {
-        deletors.push_back( function );
+        static_assert( sizeof...(Handles) <= 4, "DeletionEntry carries up to 4 handles" );
+        deletors.push_back( DeletionEntry{ op, retireValue, { ToBits( handles )... } } );
     }
-    void flush()
+
+    /// Destroying every entry whose submission has completed (retireValue <= completedValue), never the kAtShutdown ones
+    void retire( uint64_t completedValue );
+
+    /// Destroying everything, the last pushed first (the GPU has to be idle)
+    void flush();
+
+    bool empty() const
+    {
+        return deletors.empty();
+    }
+
+private:
+    template<typename T>
+    static uint64_t ToBits( T handle )
     {
-        for( auto it = deletors.rbegin(); it != deletors.rend(); ++it )
-        {
-            (*it)();    // call the function
-        }
-        deletors.clear();
+        if constexpr( std::is_pointer_v<T> )
+            return static_cast<uint64_t>( reinterpret_cast<uintptr_t>( handle ) );
+        else
+            return static_cast<uint64_t>( handle );
     }
+    static void Destroy( const DeletionEntry& entry );
 
 private:
-    std::deque<std::function<void()>> deletors;
+    std::vector<DeletionEntry> deletors;
 };
\ No newline at end of file
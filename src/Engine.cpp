@@ -1,79 +1,1535 @@
 #include "Engine.hpp"
 
+#include "BinaryFile.hpp"
 #include "DebugUtilsMessenger.hpp"
 
 #include <vector>
 #include <optional>
-#include <fstream>
-#include <shaderc/shaderc.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <limits>
 
 #ifndef SHADER_PATH
     #define SHADER_PATH
 #endif
 
+namespace
+{
+
+constexpr const char* kKernelName = "shader";   // Key of the tuning cache
+
+/// shader.comp, with BINDLESS for the pipeline that takes device addresses
+ShaderSource KernelSource( bool bindless )
+{
+    auto source = ShaderSource{ std::string(SHADER_PATH) + std::string("/shader.comp") };
+    if( bindless )
+        source.defines["BINDLESS"] = "1";
+    return source;
+}
+
+/// The writes of the compute shaders recorded so far are visible to what comes next
+void ShaderWriteBarrier( vk::CommandBuffer cmdBuffer, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess )
+{
+    auto barrier = vk::MemoryBarrier{};
+    barrier.setSrcAccessMask( vk::AccessFlagBits::eShaderWrite );
+    barrier.setDstAccessMask( dstAccess );
+    cmdBuffer.pipelineBarrier( vk::PipelineStageFlagBits::eComputeShader, dstStage, vk::DependencyFlags{}, barrier, nullptr, nullptr );
+}
+
+} // namespace
+
 // In *one* source file:
 #define VMA_IMPLEMENTATION
 #include "vk_mem_alloc.h"
 #include "vk_mem_alloc.hpp"
 
-Engine::Engine()
+Engine::Engine()
+    :
+    Engine( 0 )
+{
+}
+
+Engine::Engine( uint32_t deviceIndex )
+    :
+    m_shaderCompiler( std::string(SHADER_PATH) + "/cache" )
+{
+    auto start = std::chrono::steady_clock::now();
+
+    try
+    {
+        this->InitializeVulkanBase( deviceIndex );
+    }
+    catch( const vk::IncompatibleDriverError& )
+    {
+        // No Vulkan driver at all, same as no device
+    }
+
+    if( !m_pDevice )
+    {
+        // GPU-less node: only the CPU backend runs the jobs
+        m_startupStats.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+        return;
+    }
+
+    m_pipelineCache = PipelineCache( m_pDevice.get(), m_physicalDevice, SHADER_PATH );
+    m_tuningCache = TuningCache( m_physicalDevice, SHADER_PATH );
+
+    /// The winner of a previous Autotune() on this device, if it is still valid
+    auto tuned = m_tuningCache.Find( kKernelName );
+    m_kernelConfig = tuned && this->IsKernelConfigSupported( *tuned ) ? *tuned : this->DefaultKernelConfig();
+
+    this->CreatePipelineLayout();
+    {
+        auto pipelineStart = std::chrono::steady_clock::now();
+
+        // The variants of shader.comp are compiled together, the pipelines then find them in the memory cache
+        std::vector<ShaderSource> startupSources{ KernelSource( false ) };
+        if( m_bufferDeviceAddress )
+            startupSources.push_back( KernelSource( true ) );
+        m_shaderCompiler.CompileAll( startupSources );
+
+        m_pPipeline = this->CreatePipeline( m_kernelConfig );
+        if( m_bufferDeviceAddress )
+            m_pBindlessPipeline = this->CreateBindlessPipeline( m_kernelConfig );
+        m_startupStats.pipelineSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - pipelineStart ).count();
+    }
+
+    this->CreateDescriptorPool();
+    m_binding.set = this->AllocateDescriptorSet();
+
+    this->PrepareCommandPool();
+    this->PrepareCommandBuffer();
+
+    if( m_timestampValidBits != 0 )
+    {
+        auto statistics = m_physicalDevice.getFeatures().pipelineStatisticsQuery;    // Enabled by CreateDevice() when available
+        m_profiler = Profiler( m_pDevice.get(), kSlotCount + 1, m_timestampPeriod, m_timestampValidBits, statistics );
+    }
+
+    this->SetMemoryStrategy( MemoryStrategy::eAuto );
+
+    m_startupStats.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    m_startupStats.warmPipelineCache = m_pipelineCache.IsWarm();
+    m_startupStats.shaderCache = m_shaderCompiler.GetStats();
+}
+
+Engine::~Engine()
+{
+    this->StopAsync();
+
+    if( m_pDevice )
+    {
+        m_pDevice->waitIdle();
+        m_pipelineCache.Save();     // For the next start
+    }
+
+    // Queued behind the allocator, so flush() destroys them first
+    this->DestroyBuffers( m_binding );
+    for( auto& slot : m_slots )
+        this->DestroyBuffers( slot.binding );
+    m_importBinding.input.Destroy();
+    m_importBinding.output.Destroy();
+    m_libraryResult.Destroy();
+    for( auto& slot : m_slots )
+        slot.transientArena.Destroy();
+    m_uploadRing.Destroy();
+    m_readbackRing.Destroy();
+    for( auto& pool : m_pools )
+        pool.Destroy();
+
+    m_delQueue.flush();
+}
+
+ComputeTimings Engine::Compute( std::span<const uint32_t> input, std::span<float> output )
+{
+    if( output.size() < input.size() )
+        throw std::runtime_error("Output is smaller than input");
+    if( input.empty() )
+        return ComputeTimings{};
+
+    auto useCpu = this->UseCpu( input.size() );     // May calibrate, before the timings of this job start
+    m_timings = ComputeTimings{};
+    auto start = m_profiler.Now();
+
+    if( useCpu )
+    {
+        m_cpuBackend.Compute( input, output );
+        return this->FinishTimings( "Compute (CPU)", start );
+    }
+
+    this->ComputeGpu( input.data(), StorageType::eUint32, output.data(), StorageType::eFloat32, input.size() );
+    return this->FinishTimings( "Compute", start );
+}
+
+ComputeTimings Engine::ComputeNarrow( const void* input, StorageType inputType, size_t inputCount, void* output, StorageType outputType, size_t outputCount )
+{
+    if( !IsInputStorage( inputType ) || !IsOutputStorage( outputType ) )
+        throw std::runtime_error("Unsupported storage types of the kernel");
+    if( inputType == StorageType::eUint32 && outputType == StorageType::eFloat32 )
+        return this->Compute( std::span<const uint32_t>( static_cast<const uint32_t*>( input ), inputCount ),
+                              std::span<float>( static_cast<float*>( output ), outputCount ) );
+    if( outputCount < inputCount )
+        throw std::runtime_error("Output is smaller than input");
+    if( inputCount == 0 )
+        return ComputeTimings{};
+
+    auto useCpu = this->UseCpu( inputCount );   // May calibrate, before the timings of this job start
+    m_timings = ComputeTimings{};
+    auto start = m_profiler.Now();
+
+    if( !useCpu && this->IsStorageSupported( inputType ) && this->IsStorageSupported( outputType ) )
+    {
+        this->ComputeGpu( input, inputType, output, outputType, inputCount );
+        return this->FinishTimings( "Compute (narrow storage)", start );
+    }
+
+    /// The 32-bit kernel over chunks widened by the host. A float output is written in place,
+    /// a half one goes through a float chunk first.
+    auto chunkSize = std::min( inputCount, kConvertChunkSize );
+    std::vector<uint32_t> wideInput( chunkSize );
+    std::vector<float> wideOutput( outputType == StorageType::eFloat16 ? chunkSize : 0 );
+    auto inputBytes = static_cast<const uint8_t*>( input );
+    for( size_t offset = 0; offset < inputCount; offset += chunkSize )
+    {
+        auto count = std::min( chunkSize, inputCount - offset );
+        WidenToUint32( inputBytes + offset * GetStorageSize( inputType ), inputType, wideInput.data(), count );
+        auto in = std::span<const uint32_t>( wideInput ).first( count );
+        auto out = wideOutput.empty() ? std::span<float>( static_cast<float*>( output ) + offset, count ) : std::span<float>( wideOutput ).first( count );
+
+        if( useCpu )
+            m_cpuBackend.Compute( in, out );
+        else
+            this->ComputeGpu( in.data(), StorageType::eUint32, out.data(), StorageType::eFloat32, count );
+
+        if( !wideOutput.empty() )
+            FloatToHalf( out.data(), static_cast<Float16*>( output ) + offset, count );
+    }
+    return this->FinishTimings( useCpu ? "Compute (CPU, host conversion)" : "Compute (host conversion)", start );
+}
+
+void Engine::ComputeGpu( const void* input, StorageType inputType, void* output, StorageType outputType, size_t elementCount )
+{
+    auto tileSize = this->GetTileSize( elementCount );
+    auto inputSize = GetStorageSize( inputType );
+    auto outputSize = GetStorageSize( outputType );
+    auto pipeline = this->GetStoragePipeline( inputType, outputType );
+
+    /// Large and suitably aligned spans are used by the GPU in place, without any copy. The driver may
+    /// still refuse the pages (read-only, file mapping), then the staging path below runs.
+    if( pipeline == m_pPipeline.get() &&
+        elementCount <= tileSize &&
+        this->CanImportHostMemory( input, elementCount * sizeof(uint32_t) ) &&
+        this->CanImportHostMemory( output, elementCount * sizeof(float) ) &&
+        this->ComputeImported( std::span<const uint32_t>( static_cast<const uint32_t*>( input ), elementCount ),
+                               std::span<float>( static_cast<float*>( output ), elementCount ) ) )
+    {
+        return;
+    }
+
+    /// Device-local tiles also fit in the staging rings: the upload, the dispatch and the download of a tile
+    /// are one batch (FlushTransfersAround()), that the host waits once. Only a pipeline specialized for
+    /// a larger count goes through the rings in several batches.
+    auto elementsPerGroup = static_cast<size_t>( m_kernelConfig.GetElementsPerGroup() );
+    auto stagedTileSize = std::max( kStagingRingSize / std::max( inputSize, outputSize ) / elementsPerGroup * elementsPerGroup, elementsPerGroup );
+    auto fitStaging = [&]( size_t tile ){
+        return m_binding.deviceLocal && m_kernelConfig.elementCount == 0 ? std::min( tile, stagedTileSize ) : tile;
+    };
+    tileSize = fitStaging( tileSize );
+    this->FlushTransfers();     // The rings are empty for the tiles
+
+    /// One tile after the other through the same buffers. The budget is read again before every large tile,
+    /// so the tiles (and the buffers) shrink when another process takes memory. The buffers are sized
+    /// for 32-bit elements, narrow ones only use the start of them.
+    auto inputBytes = static_cast<const uint8_t*>( input );
+    auto outputBytes = static_cast<uint8_t*>( output );
+    auto recordDispatch = [&]( uint32_t tileCount ){
+        return [this, pipeline, tileCount]( vk::CommandBuffer cmdBuffer ){
+            this->RecordDispatch( cmdBuffer, pipeline, m_kernelConfig, m_binding.set.get(), tileCount );
+        };
+    };
+    for( size_t offset = 0; offset < elementCount; )
+    {
+        auto tileCount = static_cast<uint32_t>( std::min( elementCount - offset, tileSize ) );
+        bool batched = !m_binding.deviceLocal || tileCount <= stagedTileSize;
+
+        /// Before doing computing
+        {
+            if( m_binding.capacity > tileSize )
+            {
+                this->DestroyBuffers( m_binding );  // Waited with the previous tile, gone with the garbage
+                this->CollectGarbage();
+            }
+            this->ReserveBuffers( m_binding, tileCount, tileSize );
+        }
+
+        auto tileInput = inputBytes + offset * inputSize;
+        auto tileOutput = outputBytes + offset * outputSize;
+        if( batched )
+        {
+            this->Upload( m_binding.input, 0, tileInput, tileCount * inputSize );
+            this->Download( m_binding.output, 0, tileOutput, tileCount * outputSize );    // Recorded after the dispatch
+            this->FlushTransfersAround( recordDispatch( tileCount ) );
+        }
+        else
+        {
+            this->Upload( m_binding.input, 0, tileInput, tileCount * inputSize );
+            this->FlushTransfers();
+            this->FlushTransfersAround( recordDispatch( tileCount ) );
+            this->Download( m_binding.output, 0, tileOutput, tileCount * outputSize );
+            this->FlushTransfers();
+        }
+
+        offset += tileCount;
+        if( offset < elementCount )
+            tileSize = fitStaging( this->GetTileSize( elementCount - offset ) );
+    }
+}
+
+MemoryBudget Engine::GetMemoryBudget()
+{
+    this->RequireGpu();
+
+    // VMA reads the budget of the driver again on a new frame index (else only every 30 allocations)
+    vmaSetCurrentFrameIndex( static_cast<VmaAllocator>( m_allocator ), ++m_budgetFrameIndex );
+
+    std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets{};
+    vmaGetHeapBudgets( static_cast<VmaAllocator>( m_allocator ), budgets.data() );
+    const auto& heap = budgets[m_budgetHeaps[m_binding.deviceLocal ? 1 : 0]];
+    return MemoryBudget{ heap.usage, heap.budget };
+}
+
+void Engine::SetMaxTileSize( size_t elementCount )
+{
+    m_maxTileSize = elementCount;
+}
+
+size_t Engine::GetTileSize( size_t elementCount )
+{
+    size_t elementsPerGroup = m_kernelConfig.GetElementsPerGroup();
+    size_t maxTile = std::numeric_limits<uint32_t>::max() / elementsPerGroup * elementsPerGroup;
+    if( m_kernelConfig.elementCount != 0 )
+        return maxTile;     // The pipeline only works for one count, the job is never split
+
+    /// What is left fits in the buffers already there, or in a tile of the smallest size: one tile
+    /// whatever the budget, without asking the driver
+    auto tile = std::min( std::max( m_binding.capacity, kMinTileSize ), maxTile );
+    if( m_maxTileSize != 0 )
+        tile = std::min( tile, std::max( m_maxTileSize, elementsPerGroup ) );
+    if( elementCount <= tile )
+        return tile;
+
+    /// The buffers of Compute() are in the usage already, they are reused or replaced by the next ones
+    auto budget = this->GetMemoryBudget();
+    constexpr uint64_t kElementBytes = sizeof(uint32_t) + sizeof(float);
+    uint64_t available = budget.budget > budget.usage ? budget.budget - budget.usage : 0;
+    available += static_cast<uint64_t>( m_binding.capacity ) * kElementBytes;
+
+    tile = static_cast<size_t>( static_cast<double>( available ) * kBudgetShare ) / kElementBytes;
+    tile = std::clamp( tile / elementsPerGroup * elementsPerGroup, std::min( kMinTileSize, maxTile ), maxTile );
+    if( m_maxTileSize != 0 )
+        tile = std::min( tile, std::max( m_maxTileSize, elementsPerGroup ) );
+    return tile;
+}
+
+uint32_t Engine::FindBudgetHeap( bool deviceLocal ) const
+{
+    /// The largest heap of the kind (VRAM, or host memory for the mapped buffers of a discrete GPU),
+    /// else the largest one (integrated GPUs only have device-local heaps)
+    auto props = m_physicalDevice.getMemoryProperties();
+    std::optional<uint32_t> heapIndex;
+    for( uint32_t pass = 0; pass < 2 && !heapIndex; ++pass )
+    {
+        for( uint32_t i = 0; i < props.memoryHeapCount; ++i )
+        {
+            bool local = static_cast<bool>( props.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal );
+            if( pass == 0 && local != deviceLocal )
+                continue;
+            if( !heapIndex || props.memoryHeaps[i].size > props.memoryHeaps[*heapIndex].size )
+                heapIndex = i;
+        }
+    }
+    return heapIndex.value_or( 0 );
+}
+
+ComputeTimings Engine::Compute( const BufferRange& input, const BufferRange& output )
+{
+    return this->Compute( input, StorageType::eUint32, output, StorageType::eFloat32 );
+}
+
+ComputeTimings Engine::Compute( const BufferRange& input, StorageType inputType, const BufferRange& output, StorageType outputType )
+{
+    this->RequireGpu();
+    if( !IsInputStorage( inputType ) || !IsOutputStorage( outputType ) )
+        throw std::runtime_error("Unsupported storage types of the kernel");
+    auto pipeline = this->GetStoragePipeline( inputType, outputType );  // Throws if the device does not support them
+
+    auto elementCount = input.size / GetStorageSize( inputType );
+    if( output.size < elementCount * GetStorageSize( outputType ) )
+        throw std::runtime_error("Output is smaller than input");
+    if( elementCount > UINT32_MAX )
+        throw std::runtime_error("Input is too large for a single compute job");
+    if( elementCount == 0 )
+        return ComputeTimings{};
+
+    m_timings = ComputeTimings{};
+    auto start = m_profiler.Now();
+
+    auto& slot = this->AcquireSlot();
+
+    if( pipeline == m_pPipeline.get() && this->UseBindless( input, output ) )
+    {
+        this->Submit( slot, input, output, static_cast<uint32_t>( elementCount ) );
+    }
+    else
+    {
+        /// The descriptor set of the slot is only re-written when the ranges changed
+        auto sameRange = []( const BufferRange& a, const BufferRange& b ){
+            return a.buffer == b.buffer && a.offset == b.offset && a.size == b.size;
+        };
+        auto& binding = slot.rangeBinding;
+        if( !sameRange( binding.inputRange, input ) || !sameRange( binding.outputRange, output ) )
+        {
+            if( !binding.set )
+                binding.set = this->AllocateDescriptorSet();
+            binding.inputRange = input;
+            binding.outputRange = output;
+            this->UpdateDescriptorSet( binding );
+            ++binding.generation;
+        }
+
+        this->Submit( slot, binding, static_cast<uint32_t>( elementCount ), pipeline );
+    }
+
+    this->WaitTimeline( *m_pComputeQueue, slot.submittedValue );
+    this->CollectTimings( slot );
+
+    return this->FinishTimings( "Compute", start );
+}
+
+std::future<void> Engine::SubmitAsync( const BufferRange& input, const BufferRange& output )
+{
+    this->RequireGpu();
+
+    auto elementCount = input.size / sizeof(uint32_t);
+    if( output.size < elementCount * sizeof(float) )
+        throw std::runtime_error("Output is smaller than input");
+    if( elementCount > UINT32_MAX )
+        throw std::runtime_error("Input is too large for a single compute job");
+    if( m_kernelConfig.elementCount != 0 && m_kernelConfig.elementCount != elementCount )
+        throw std::runtime_error("The pipeline has been specialized for another element count");
+
+    auto job = AsyncJob{ input, output, static_cast<uint32_t>( elementCount ) };
+    auto future = job.promise.get_future();
+    if( elementCount == 0 )
+    {
+        job.promise.set_value();
+        return future;
+    }
+
+    std::call_once( m_asyncStarted, [this](){ this->StartAsync(); } );
+
+    m_asyncJobs.Push( std::move( job ) );
+    m_asyncPushed.fetch_add( 1, std::memory_order_release );
+    m_asyncPushed.notify_one();
+    return future;
+}
+
+BufferRange Engine::AllocateBuffer( size_t size, BufferIntent intent )
+{
+    this->RequireGpu();
+
+    auto& pool = m_pools[static_cast<size_t>( intent )];
+    if( !pool.IsInitialized() )
+    {
+        auto usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst
+                   | vk::BufferUsageFlagBits::eIndirectBuffer;     // Dispatch arguments of the indirect stages
+        if( m_bufferDeviceAddress )
+            usage |= vk::BufferUsageFlagBits::eShaderDeviceAddress;     // Bindless
+        // Device-local ranges are copied on the transfer queue and read by the compute queues
+        auto families = intent == BufferIntent::eDeviceLocal ? this->SharedQueueFamilies() : std::vector<uint32_t>{};
+        pool = BufferPool( m_allocator, kPoolBlockSize, usage, intent, m_storageAlignment, families );
+    }
+
+    return pool.Allocate( size );
+}
+
+void Engine::FreeBuffer( const BufferRange& range )
+{
+    for( auto& pool : m_pools )
+    {
+        if( pool.Owns( range ) )
+        {
+            m_delQueue.push( DestroyOp::eBufferRange, m_pComputeQueue->submittedValue.load(),
+                             &pool, static_cast<VkBuffer>( range.buffer ), range.offset, range.size );
+            return;
+        }
+    }
+
+    throw std::runtime_error("Freeing a range that is not from the engine's pools");
+}
+
+BufferRange Engine::AllocateTransient( size_t size )
+{
+    this->RequireGpu();
+
+    auto& slot = m_slots[m_slotIndex];     // The slot of the next submission
+
+    // The previous submission of this slot has to be finished before its memory is handed out again
+    if( slot.transientInFlight )
+    {
+        this->WaitTimeline( *m_pComputeQueue, slot.submittedValue );
+        slot.transientArena.Reset();
+        slot.transientInFlight = false;
+    }
+
+    if( slot.transientArena.GetSize() == 0 )
+    {
+        auto usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst;
+        if( m_bufferDeviceAddress )
+            usage |= vk::BufferUsageFlagBits::eShaderDeviceAddress;     // Bindless
+        slot.transientArena = LinearArena( m_allocator, kTransientArenaSize, usage, BufferIntent::eReadback, m_storageAlignment );
+    }
+
+    auto range = slot.transientArena.Allocate( size );
+    if( !range )
+        throw std::runtime_error("Transient arena is full");
+
+    return *range;
+}
+
+const KernelConfig& Engine::GetKernelConfig() const
+{
+    return m_kernelConfig;
+}
+
+void Engine::SetKernelConfig( const KernelConfig& config )
+{
+    this->RequireGpu();
+    if( !this->IsKernelConfigSupported( config ) )
+        throw std::runtime_error("Kernel configuration is not supported by the device");
+
+    // The recorded command buffers still use the old pipeline, so it is destroyed once they have completed
+    auto pipeline = this->CreatePipeline( config );
+    this->DestroyDeferred( DestroyOp::ePipeline, static_cast<VkDevice>( m_pDevice.get() ), static_cast<VkPipeline>( m_pPipeline.release() ) );
+    m_pPipeline = std::move( pipeline );
+    if( m_pBindlessPipeline )
+    {
+        auto bindlessPipeline = this->CreateBindlessPipeline( config );
+        this->DestroyDeferred( DestroyOp::ePipeline, static_cast<VkDevice>( m_pDevice.get() ), static_cast<VkPipeline>( m_pBindlessPipeline.release() ) );
+        m_pBindlessPipeline = std::move( bindlessPipeline );
+    }
+    m_kernelConfig = config;
+
+    for( auto& slot : m_slots )
+        slot.recordedCount = 0;     // Re-recorded by their next submission
+}
+
+KernelConfig Engine::Autotune( size_t elementCount )
+{
+    this->RequireGpu();
+    if( !m_profiler.IsInitialized() )
+        throw std::runtime_error("The compute queue does not support timestamp queries");
+    if( elementCount == 0 || elementCount > UINT32_MAX )
+        throw std::runtime_error("Invalid element count");
+
+    auto candidates = this->AutotuneCandidates();
+    if( candidates.empty() )
+        return m_kernelConfig;
+
+    /// Device-local, so the timing is the kernel and not the PCIe bus. The content does not matter.
+    auto binding = IoBinding{};
+    binding.deviceLocal = true;
+    this->ReserveBuffers( binding, elementCount );
+
+    auto best = m_kernelConfig;
+    double bestSeconds = std::numeric_limits<double>::max();
+    for( const auto& candidate : candidates )
+    {
+        auto pPipeline = this->CreatePipeline( candidate );
+        auto count = static_cast<uint32_t>( elementCount );
+
+        this->TimeDispatch( pPipeline.get(), candidate, binding.set.get(), count );   // Warming up (caches, clocks)
+
+        std::vector<double> runs( kAutotuneRuns );
+        for( auto& run : runs )
+            run = this->TimeDispatch( pPipeline.get(), candidate, binding.set.get(), count );
+        std::nth_element( runs.begin(), runs.begin() + runs.size() / 2, runs.end() );
+
+        auto median = runs[runs.size() / 2];
+        if( median < bestSeconds )
+        {
+            bestSeconds = median;
+            best = candidate;
+        }
+    }   // Every dispatch has been waited, the pipeline can be destroyed right away
+
+    this->DestroyBuffers( binding );
+
+    this->SetKernelConfig( best );
+    m_tuningCache.Store( kKernelName, best );
+    return best;
+}
+
+bool Engine::HasGpu() const
+{
+    return static_cast<bool>( m_pDevice );
+}
+
+std::string Engine::GetDeviceName() const
+{
+    if( !m_pDevice )
+        return "cpu";
+    return std::string( m_physicalDevice.getProperties().deviceName.data() );
+}
+
+uint32_t Engine::CountGpus()
+{
+    try
+    {
+        // Without layers nor extensions, only for enumerating
+        auto appInfo = vk::ApplicationInfo{ "CE", VK_MAKE_VERSION( 0, 1, 0 ), "CE-Engine", VK_MAKE_VERSION( 1, 0, 0 ), VK_API_VERSION_1_3 };
+        auto instanceInfo = vk::InstanceCreateInfo{};
+        instanceInfo.setPApplicationInfo( &appInfo );
+        auto pInstance = vk::createInstanceUnique( instanceInfo );
+
+        auto physicalDevices = pInstance->enumeratePhysicalDevices();
+        return static_cast<uint32_t>( std::count_if( physicalDevices.begin(), physicalDevices.end(), &Engine::IsPhysicalDeviceSuitable ) );
+    }
+    catch( const vk::SystemError& )
+    {
+        return 0;   // No driver, or one that refuses the instance
+    }
+}
+
+void Engine::SetBackend( Backend backend )
+{
+    m_backend = backend;
+}
+
+size_t Engine::CalibrateCpuThreshold()
+{
+    this->RequireGpu();
+
+    /// Linear model of each backend, t(n) = latency + n * cost, fitted on a small and a big job
+    constexpr size_t kSmall = 1 << 10;
+    constexpr size_t kLarge = 1 << 20;
+    std::vector<uint32_t> input( kLarge, 1 );
+    std::vector<float> output( kLarge );
+
+    auto median = [&]( size_t count, bool cpu ){
+        auto in = std::span<const uint32_t>( input ).first( count );
+        auto out = std::span<float>( output ).first( count );
+        std::vector<double> runs( kCalibrationRuns + 1 );
+        for( auto& run : runs )     // The first one is a warm-up (buffers, thread pool)
+        {
+            auto start = std::chrono::steady_clock::now();
+            if( cpu )
+                m_cpuBackend.Compute( in, out );
+            else
+                this->ComputeGpu( in.data(), StorageType::eUint32, out.data(), StorageType::eFloat32, count );
+            run = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+        }
+        std::nth_element( runs.begin() + 1, runs.begin() + 1 + kCalibrationRuns / 2, runs.end() );
+        return runs[1 + kCalibrationRuns / 2];
+    };
+
+    auto gpuSmall = median( kSmall, false );
+    auto gpuCost = ( median( kLarge, false ) - gpuSmall ) / ( kLarge - kSmall );
+    auto gpuLatency = gpuSmall - gpuCost * kSmall;
+    auto cpuSmall = median( kSmall, true );
+    auto cpuCost = ( median( kLarge, true ) - cpuSmall ) / ( kLarge - kSmall );
+    auto cpuLatency = cpuSmall - cpuCost * kSmall;
+
+    // The CPU has the smaller latency, the GPU (usually) the smaller cost per element.
+    // If the CPU wins on both, it takes every job.
+    size_t threshold = std::numeric_limits<size_t>::max();
+    if( cpuCost > gpuCost )
+        threshold = static_cast<size_t>( std::max( ( gpuLatency - cpuLatency ) / ( cpuCost - gpuCost ), 0.0 ) );
+
+    m_cpuThreshold = threshold;
+    return threshold;
+}
+
+void Engine::SetCpuThreshold( size_t elementCount )
+{
+    m_cpuThreshold = elementCount;
+}
+
+bool Engine::UseCpu( size_t elementCount )
+{
+    if( !m_pDevice )
+        return true;
+
+    switch( m_backend )
+    {
+    case Backend::eGpu:
+        return false;
+    case Backend::eCpu:
+        return true;
+    case Backend::eAuto:
+        break;
+    }
+
+    if( !m_cpuThreshold )
+        this->CalibrateCpuThreshold();
+    return elementCount < *m_cpuThreshold;
+}
+
+void Engine::RequireGpu() const
+{
+    if( !m_pDevice )
+        throw std::runtime_error("No Vulkan device, only Compute( span, span ) and ComputeStreaming() are available");
+}
+
+bool Engine::IsBindlessSupported() const
+{
+    return static_cast<bool>( m_pBindlessPipeline );
+}
+
+void Engine::EnableBindless( bool enable )
+{
+    if( enable && !this->IsBindlessSupported() )
+        throw std::runtime_error("The device does not support buffer device addresses");
+    m_bindless = enable;
+}
+
+bool Engine::IsStorageSupported( StorageType type ) const
+{
+    if( !m_pDevice )
+        return false;
+
+    switch( type )
+    {
+    case StorageType::eUint8:
+        return m_storage8Bit;
+    case StorageType::eUint16:
+    case StorageType::eFloat16:
+        return m_storage16Bit;
+    default:
+        return true;
+    }
+}
+
+vk::Pipeline Engine::GetStoragePipeline( StorageType inputType, StorageType outputType )
+{
+    if( inputType == StorageType::eUint32 && outputType == StorageType::eFloat32 )
+        return m_pPipeline.get();
+    if( !this->IsStorageSupported( inputType ) || !this->IsStorageSupported( outputType ) )
+        throw std::runtime_error("The device does not support the 8/16-bit storage of these types");
+
+    auto source = ShaderSource{ std::string(SHADER_PATH) + std::string("/shader.comp"), GetStorageDefines( inputType, outputType ) };
+    return this->GetCachedPipeline( source, m_pPipelineLayout.get(), m_kernelConfig );
+}
+
+bool Engine::IsProfilingSupported() const
+{
+    return m_profiler.IsInitialized();
+}
+
+void Engine::EnableProfiling( bool enable )
+{
+    if( enable && !m_profiler.IsInitialized() )
+        throw std::runtime_error("The compute queue does not support timestamp queries");
+    if( enable == m_profiling )
+        return;
+
+    m_profiling = enable;
+    if( enable )
+        m_profiler.ClearEvents();   // The trace starts now
+
+    for( auto& slot : m_slots )
+        slot.recordedCount = 0;     // Re-recorded with (or without) the queries by their next submission
+}
+
+bool Engine::WriteTrace( const std::string& path ) const
+{
+    return m_profiler.WriteTrace( path );
+}
+
+void Engine::ReduceRange( const BufferRange& input, ReduceOp op, ElementType type, void* result )
+{
+    this->RequireGpu();
+
+    auto elementCount = input.size / sizeof(uint32_t);     // Every element type is 4 bytes
+    if( elementCount == 0 )
+        throw std::runtime_error("Reducing an empty range");
+    if( elementCount > UINT32_MAX )
+        throw std::runtime_error("Input is too large for a single compute job");
+
+    /// Enough workgroups to fill the GPU, few enough that one workgroup folds their partials
+    size_t elementsPerGroup = m_libraryLocalSize * kLibraryItems;
+    auto groupCount = static_cast<uint32_t>( std::min<size_t>( { ( elementCount + elementsPerGroup - 1 ) / elementsPerGroup,
+                                                                 kReduceMaxGroups, m_maxGroupCountX } ) );
+
+    auto partials = this->AllocateBuffer( groupCount * sizeof(uint32_t), BufferIntent::eDeviceLocal );
+    if( m_libraryResult.GetSize() == 0 )
+        m_libraryResult = Buffer( m_allocator, sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer, BufferIntent::eReadback );
+    auto resultRange = m_libraryResult.GetRange();
+
+    auto pipeline = this->GetLibraryPipeline( LibraryKernel::eReduce, op, type );
+    auto pFirstSet = this->AllocateLibrarySet( m_pLibrarySetLayout.get(), { input, partials, partials } );  // No block totals, binding 2 is not used
+    auto pSecondSet = this->AllocateLibrarySet( m_pLibrarySetLayout.get(), { partials, resultRange, resultRange } );
+
+    auto cmdBuffer = this->BeginImmediate();
+    ShaderWriteBarrier( cmdBuffer, vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead );   // Earlier jobs wrote the input
+    this->RecordLibraryDispatch( cmdBuffer, m_pLibraryLayout.get(), pipeline, pFirstSet.get(), LibraryParams{ static_cast<uint32_t>( elementCount ) }, groupCount );
+    ShaderWriteBarrier( cmdBuffer, vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead );
+    this->RecordLibraryDispatch( cmdBuffer, m_pLibraryLayout.get(), pipeline, pSecondSet.get(), LibraryParams{ groupCount }, 1 );
+    ShaderWriteBarrier( cmdBuffer, vk::PipelineStageFlagBits::eHost, vk::AccessFlagBits::eHostRead );
+    this->SubmitImmediate();
+
+    this->CopyFromBuffer( static_cast<char*>( result ), sizeof(uint32_t), m_libraryResult );
+    this->FreeBuffer( partials );
+}
+
+void Engine::ScanRange( const BufferRange& input, const BufferRange& output, ReduceOp op, ElementType type, ScanMode mode )
+{
+    this->RequireGpu();
+
+    auto elementCount = input.size / sizeof(uint32_t);
+    if( output.size < elementCount * sizeof(uint32_t) )
+        throw std::runtime_error("Output is smaller than input");
+    if( elementCount > UINT32_MAX )
+        throw std::runtime_error("Input is too large for a single compute job");
+    if( elementCount == 0 )
+        return;
+
+    auto plan = this->PlanScan( static_cast<uint32_t>( elementCount ) );
+    auto scratch = plan.scratchSize != 0 ? this->AllocateBuffer( plan.scratchSize, BufferIntent::eDeviceLocal ) : BufferRange{};
+    auto sets = this->AllocateScanSets( plan, input, output, scratch );
+
+    auto cmdBuffer = this->BeginImmediate();
+    ShaderWriteBarrier( cmdBuffer, vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite );
+    this->RecordScan( cmdBuffer, plan, sets, op, type, mode );
+    ShaderWriteBarrier( cmdBuffer, vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eHost,
+                        vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eHostRead );
+    this->SubmitImmediate();
+
+    if( plan.scratchSize != 0 )
+        this->FreeBuffer( scratch );
+}
+
+void Engine::SortRange( const BufferRange& keys, const BufferRange& values, ElementType keyType )
+{
+    this->RequireGpu();
+
+    auto elementCount = keys.size / sizeof(uint32_t);
+    bool hasValues = values.size != 0;
+    if( hasValues && values.size < elementCount * sizeof(uint32_t) )
+        throw std::runtime_error("Fewer values than keys");
+    if( elementCount > UINT32_MAX )
+        throw std::runtime_error("Input is too large for a single compute job");
+    if( elementCount <= 1 )
+        return;
+
+    auto count = static_cast<uint32_t>( elementCount );
+    auto blockCount = this->GetLibraryBlockCount( count, kSortItems );
+    auto histogramCount = static_cast<uint64_t>( blockCount ) << kSortRadixBits;
+    if( histogramCount > UINT32_MAX )
+        throw std::runtime_error("Input is too large for a single compute job");
+    auto plan = this->PlanScan( static_cast<uint32_t>( histogramCount ) );
+
+    /// Scratch: the second copy of the keys (and of the values), the histogram and the levels of its scan.
+    /// Kept for the next sorts, it only grows.
+    auto align = [this]( size_t size ){
+        return ( size + m_storageAlignment - 1 ) / m_storageAlignment * m_storageAlignment;
+    };
+    size_t elementsSize = count * sizeof(uint32_t);
+    size_t valuesOffset = align( elementsSize );
+    size_t histogramOffset = valuesOffset + ( hasValues ? align( elementsSize ) : 0 );
+    size_t scanOffset = histogramOffset + align( histogramCount * sizeof(uint32_t) );
+    size_t scratchSize = scanOffset + plan.scratchSize;
+    if( m_sortScratch.size < scratchSize )
+    {
+        if( m_sortScratch.size != 0 )
+            this->FreeBuffer( m_sortScratch );
+        m_sortScratch = BufferRange{};
+        m_sortScratch = this->AllocateBuffer( scratchSize, BufferIntent::eDeviceLocal );
+    }
+    auto part = [this]( size_t offset, size_t size ){
+        auto range = m_sortScratch;
+        range.offset += offset;
+        range.size = size;
+        return range;
+    };
+    auto otherKeys = part( 0, elementsSize );
+    auto otherValues = hasValues ? part( valuesOffset, elementsSize ) : otherKeys;     // Not used without values
+    auto histogram = part( histogramOffset, histogramCount * sizeof(uint32_t) );
+    auto sourceValues = hasValues ? values : keys;
+
+    /// Even passes go from the keys to the scratch, odd ones come back, so the sorted keys end where they were
+    std::array<vk::UniqueDescriptorSet, 2> sets {
+        this->AllocateLibrarySet( m_pSortSetLayout.get(), { keys, otherKeys, histogram, sourceValues, otherValues } ),
+        this->AllocateLibrarySet( m_pSortSetLayout.get(), { otherKeys, keys, histogram, otherValues, sourceValues } ),
+    };
+    auto scanSets = this->AllocateScanSets( plan, histogram, histogram, part( scanOffset, plan.scratchSize ) );
+
+    auto sortPath = std::string(SHADER_PATH) + std::string("/sort.comp");
+    auto histogramPipeline = this->GetCachedPipeline( ShaderSource{ sortPath, GetSortDefines( SortKernel::eHistogram, keyType, false, m_subgroupArithmetic, kSortItems ) },
+                                                      m_pSortLayout.get(), this->LibraryKernelConfig() );
+    auto scatterPipeline = this->GetCachedPipeline( ShaderSource{ sortPath, GetSortDefines( SortKernel::eScatter, keyType, hasValues, m_subgroupArithmetic, kSortItems ) },
+                                                    m_pSortLayout.get(), this->LibraryKernelConfig() );
+
+    /// Every pass in one submission
+    auto cmdBuffer = this->BeginImmediate();
+    auto computeBarrier = [cmdBuffer](){
+        ShaderWriteBarrier( cmdBuffer, vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite );
+    };
+    computeBarrier();
+    for( uint32_t shift = 0; shift < 32; shift += kSortRadixBits )
+    {
+        auto set = sets[( shift / kSortRadixBits ) % 2].get();
+        auto params = LibraryParams{ count, 0, 0, shift, blockCount };
+
+        this->RecordLibraryDispatch( cmdBuffer, m_pSortLayout.get(), histogramPipeline, set, params, blockCount );
+        computeBarrier();
+        this->RecordScan( cmdBuffer, plan, scanSets, ReduceOp::eSum, ElementType::eUint32, ScanMode::eExclusive );
+        computeBarrier();
+        this->RecordLibraryDispatch( cmdBuffer, m_pSortLayout.get(), scatterPipeline, set, params, blockCount );
+        computeBarrier();
+    }
+    ShaderWriteBarrier( cmdBuffer, vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eHost,
+                        vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eHostRead );
+    this->SubmitImmediate();
+}
+
+ComputeTimings Engine::Execute( const ComputeGraph& graph )
+{
+    this->RequireGpu();
+
+    const auto& stages = graph.GetStages();
+    if( stages.empty() )
+        return ComputeTimings{};
+
+    m_timings = ComputeTimings{};
+    auto start = m_profiler.Now();
+
+    auto plan = graph.Compile( m_storageAlignment );
+
+    /// Pipeline and configuration of every stage (shader.comp without a kernel, as tuned). The kernel
+    /// of an indirect stage is compiled with INDIRECT, for the dispatch arguments at binding 2.
+    std::vector<vk::Pipeline> pipelines( stages.size() );
+    std::vector<KernelConfig> configs( stages.size() );
+    vk::Pipeline dispatchArgsPipeline;     // dispatch.comp, with indirect stages
+    for( size_t s = 0; s < stages.size(); ++s )
+    {
+        const auto& stage = stages[s];
+        if( stage.kernel.path.empty() && !stage.dispatchArgs )
+        {
+            pipelines[s] = m_pPipeline.get();
+            configs[s] = m_kernelConfig;
+        }
+        else if( stage.kernel.path.empty() )
+        {
+            configs[s] = m_kernelConfig;
+            auto source = ShaderSource{ std::string(SHADER_PATH) + std::string("/shader.comp"), ShaderDefines{ { "INDIRECT", "1" } } };
+            pipelines[s] = this->GetCachedPipeline( source, m_pIndirectLayout.get(), configs[s] );
+        }
+        else
+        {
+            configs[s] = stage.config.value_or( this->DefaultKernelConfig() );
+            if( !this->IsKernelConfigSupported( configs[s] ) )
+                throw std::runtime_error("Kernel configuration is not supported by the device");
+            auto source = stage.kernel;
+            if( stage.dispatchArgs )
+                source.defines["INDIRECT"] = "1";
+            pipelines[s] = this->GetCachedPipeline( source, stage.dispatchArgs ? m_pIndirectLayout.get() : m_pPipelineLayout.get(), configs[s] );
+        }
+
+        if( !stage.dispatchArgs )
+            continue;
+
+        // A single indirect dispatch: the capacity of the stage is within the device limit of group count
+        uint32_t elementsPerGroup = configs[s].GetElementsPerGroup();
+        if( ( static_cast<uint64_t>( stage.elementCount ) + elementsPerGroup - 1 ) / elementsPerGroup > m_maxGroupCountX )
+            throw std::runtime_error("An indirect stage is larger than a single dispatch");
+        if( !dispatchArgsPipeline )
+        {
+            auto source = ShaderSource{ std::string(SHADER_PATH) + std::string("/dispatch.comp") };
+            dispatchArgsPipeline = this->GetCachedPipeline( source, m_pIndirectLayout.get(), this->LibraryKernelConfig() );
+        }
+    }
+
+    auto transientMemory = plan.transientSize != 0 ? this->AllocateBuffer( plan.transientSize, BufferIntent::eDeviceLocal ) : BufferRange{};
+    auto getRange = [&]( ComputeGraph::BufferId id ){
+        if( !graph.IsTransient( id ) )
+            return graph.GetBuffer( id );
+        auto range = transientMemory;
+        range.offset += plan.transientOffsets[id];
+        range.size = graph.GetBuffer( id ).size;
+        if( range.address != 0 )
+            range.address += plan.transientOffsets[id];
+        return range;
+    };
+
+    /// The direct shader.comp stages are bindless when they can, the kernels of the caller and the indirect
+    /// stages always take a set
+    std::vector<size_t> boundStages;
+    for( size_t s = 0; s < stages.size(); ++s )
+    {
+        const auto& stage = stages[s];
+        if( stage.kernel.path.empty() && !stage.dispatchArgs && this->UseBindless( getRange( stage.input ), getRange( stage.output ) ) )
+            pipelines[s] = m_pBindlessPipeline.get();
+        else
+            boundStages.push_back( s );
+    }
+
+    /// The sets come from a pool of their own, a graph may have more stages than the engine pool has sets
+    vk::UniqueDescriptorPool pDescPool;
+    std::vector<vk::DescriptorSet> sets( stages.size() );
+    if( !boundStages.empty() )
+    {
+        std::vector<vk::DescriptorPoolSize> poolSizes {
+            { vk::DescriptorType::eStorageBuffer, static_cast<uint32_t>( boundStages.size() * 3 ) }
+        };
+        auto descPoolInfo = vk::DescriptorPoolCreateInfo{};
+        descPoolInfo.setPoolSizes( poolSizes );
+        descPoolInfo.setMaxSets( static_cast<uint32_t>( boundStages.size() ) );
+        pDescPool = m_pDevice->createDescriptorPoolUnique( descPoolInfo );
+
+        std::vector<vk::DescriptorSetLayout> setLayouts;
+        for( auto s : boundStages )
+            setLayouts.push_back( stages[s].dispatchArgs ? m_pIndirectSetLayout.get() : m_pSetLayout.get() );
+        auto setAllocateInfo = vk::DescriptorSetAllocateInfo{};
+        setAllocateInfo.setDescriptorPool( pDescPool.get() );
+        setAllocateInfo.setSetLayouts( setLayouts );
+        auto allocated = m_pDevice->allocateDescriptorSets( setAllocateInfo );
+        for( size_t i = 0; i < boundStages.size(); ++i )
+            sets[boundStages[i]] = allocated[i];
+    }
+
+    for( auto s : boundStages )
+    {
+        const auto& stage = stages[s];
+
+        std::vector<ComputeGraph::BufferId> bindings{ stage.input, stage.output };
+        if( stage.dispatchArgs )
+            bindings.push_back( *stage.dispatchArgs );
+        std::vector<vk::DescriptorBufferInfo> descriptorBufferInfos;
+        for( auto id : bindings )
+        {
+            auto range = getRange( id );
+            descriptorBufferInfos.push_back( vk::DescriptorBufferInfo{ range.buffer, range.offset, range.size } );
+        }
+        auto writeDescriptorSet = vk::WriteDescriptorSet{};
+        writeDescriptorSet.setBufferInfo( descriptorBufferInfos );
+        writeDescriptorSet.setDescriptorType( vk::DescriptorType::eStorageBuffer );
+        writeDescriptorSet.setDstSet( sets[s] );
+        writeDescriptorSet.setDstBinding( 0 );
+        m_pDevice->updateDescriptorSets( writeDescriptorSet, nullptr );
+    }
+
+    /// One barrier between two waves, none within a wave. A wave with indirect stages first writes their
+    /// group counts, then waits for them as indirect arguments (one more barrier).
+    auto cmdBuffer = this->BeginImmediate();
+    if( m_profiling )
+    {
+        m_profiler.CmdReset( cmdBuffer, kTransferQueryRange );
+        m_profiler.CmdTimestamp( cmdBuffer, kTransferQueryRange, 0, vk::PipelineStageFlagBits::eTopOfPipe );
+    }
+    for( const auto& wave : plan.waves )
+    {
+        ShaderWriteBarrier( cmdBuffer, vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite );
+
+        bool indirect = false;
+        for( auto s : wave )
+        {
+            if( !stages[s].dispatchArgs )
+                continue;
+            this->RecordDispatchArgs( cmdBuffer, dispatchArgsPipeline, sets[s], configs[s], stages[s].elementCount );
+            indirect = true;
+        }
+        if( indirect )
+            ShaderWriteBarrier( cmdBuffer, vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader,
+                                vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead );
+
+        for( auto s : wave )
+        {
+            const auto& stage = stages[s];
+            if( stage.dispatchArgs )
+                this->RecordIndirectDispatch( cmdBuffer, pipelines[s], sets[s], getRange( *stage.dispatchArgs ), stage.elementCount, stage.scale );
+            else if( sets[s] )
+                this->RecordDispatch( cmdBuffer, pipelines[s], configs[s], sets[s], stage.elementCount, stage.scale );
+            else
+                this->RecordDispatch( cmdBuffer, pipelines[s], configs[s], getRange( stage.input ), getRange( stage.output ), stage.elementCount, stage.scale );
+        }
+    }
+    if( m_profiling )
+        m_profiler.CmdTimestamp( cmdBuffer, kTransferQueryRange, 1, vk::PipelineStageFlagBits::eBottomOfPipe );
+    ShaderWriteBarrier( cmdBuffer, vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eHost,
+                        vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eHostRead );
+    auto submitSeconds = m_profiler.Now();
+    this->SubmitImmediate();
+
+    if( m_profiling )
+        m_timings.dispatchSeconds = m_profiler.AddGpuEvent( "graph", kTransferQueryRange, 0, 1, submitSeconds );
+    if( plan.transientSize != 0 )
+        this->FreeBuffer( transientMemory );
+
+    return this->FinishTimings( "Execute", start );
+}
+
+const StartupStats& Engine::GetStartupStats() const
+{
+    return m_startupStats;
+}
+
+const std::string& Engine::GetPipelineCachePath() const
+{
+    return m_pipelineCache.GetFilePath();
+}
+
+StreamStats Engine::ComputeStreaming( std::span<const uint32_t> input, std::span<float> output, size_t chunkSize )
+{
+    if( output.size() < input.size() )
+        throw std::runtime_error("Output is smaller than input");
+    if( chunkSize == 0 || chunkSize > UINT32_MAX )
+        throw std::runtime_error("Invalid chunk size");
+
+    auto stats = StreamStats{};
+    if( input.empty() )
+        return stats;
+
+    chunkSize = std::min( chunkSize, input.size() );
+
+    if( this->UseCpu( input.size() ) )
+    {
+        // Nothing to overlap, the CPU backend already spreads the job over its threads
+        auto start = std::chrono::steady_clock::now();
+        m_cpuBackend.Compute( input, output );
+        stats.chunkCount = 1;
+        stats.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+        auto bytes = static_cast<double>( input.size() ) * ( sizeof(uint32_t) + sizeof(float) );
+        stats.gigabytesPerSecond = stats.seconds > 0.0 ? bytes / stats.seconds * 1e-9 : 0.0;
+        return stats;
+    }
+
+    auto fill = [input]( const Buffer& chunkInput, size_t offset, size_t count ){
+        memcpy( chunkInput.GetMappedData(), input.data() + offset, count * sizeof(uint32_t) );
+    };
+    auto drain = [output]( const Buffer& chunkOutput, size_t offset, size_t count ){
+        memcpy( output.data() + offset, chunkOutput.GetMappedData(), count * sizeof(float) );
+    };
+    return this->StreamChunks( "ComputeStreaming", input.size(), chunkSize, fill, drain );
+}
+
+StreamStats Engine::ComputeFile( const std::string& inputPath, const std::string& outputPath, size_t chunkSize )
+{
+    if( chunkSize == 0 || chunkSize > UINT32_MAX )
+        throw std::runtime_error("Invalid chunk size");
+
+    auto input = BinaryFile( inputPath, BinaryFile::Mode::eRead );
+    if( input.GetSize() % sizeof(uint32_t) != 0 )
+        throw std::runtime_error("Input file is not made of 4 bytes elements: " + inputPath);
+    auto elementCount = input.GetSize() / sizeof(uint32_t);
+
+    /// Opened without truncation: writing over the input would destroy it before it is read
+    auto output = BinaryFile( outputPath, BinaryFile::Mode::eWrite );
+    if( output.IsSameFile( input ) )
+        throw std::runtime_error("Output file is the input file: " + outputPath);
+    output.Resize( elementCount * sizeof(float) );
+
+    auto stats = StreamStats{};
+    if( elementCount == 0 )
+        return stats;
+
+    chunkSize = std::min( chunkSize, elementCount );
+
+    if( this->UseCpu( elementCount ) )
+    {
+        // Chunk by chunk as well, the heap only holds one chunk each way
+        auto start = std::chrono::steady_clock::now();
+        std::vector<uint32_t> chunkInput( chunkSize );
+        std::vector<float> chunkOutput( chunkSize );
+        for( size_t offset = 0; offset < elementCount; offset += chunkSize )
+        {
+            auto count = std::min( chunkSize, elementCount - offset );
+            input.Read( offset * sizeof(uint32_t), chunkInput.data(), count * sizeof(uint32_t) );
+            m_cpuBackend.Compute( std::span<const uint32_t>( chunkInput ).first( count ), chunkOutput );
+            output.Write( offset * sizeof(float), chunkOutput.data(), count * sizeof(float) );
+            ++stats.chunkCount;
+        }
+        stats.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+        auto bytes = static_cast<double>( elementCount ) * ( sizeof(uint32_t) + sizeof(float) );
+        stats.gigabytesPerSecond = stats.seconds > 0.0 ? bytes / stats.seconds * 1e-9 : 0.0;
+        return stats;
+    }
+
+    /// pread() into the mapped input of the slot, pwrite() from its mapped output
+    auto fill = [&input]( const Buffer& chunkInput, size_t offset, size_t count ){
+        input.Read( offset * sizeof(uint32_t), chunkInput.GetMappedData(), count * sizeof(uint32_t) );
+    };
+    auto drain = [&output]( const Buffer& chunkOutput, size_t offset, size_t count ){
+        output.Write( offset * sizeof(float), chunkOutput.GetMappedData(), count * sizeof(float) );
+    };
+    return this->StreamChunks( "ComputeFile", elementCount, chunkSize, fill, drain );
+}
+
+StreamStats Engine::StreamChunks( const char* name, size_t elementCount, size_t chunkSize, const ChunkCopy& fill, const ChunkCopy& drain )
+{
+    auto stats = StreamStats{};
+
+    // Forgetting the leftover of a previous call that has been interrupted by an exception
+    for( auto& slot : m_slots )
+        slot.pendingCount = 0;
+
+    m_timings = ComputeTimings{};
+    auto start = std::chrono::steady_clock::now();
+    auto profilerStart = m_profiler.Now();
+
+    /// Chunk k goes to slot k % kSlotCount. Acquiring its slot waits chunk k - kSlotCount,
+    /// so up to kSlotCount chunks are in flight while the CPU copies.
+    for( size_t offset = 0; offset < elementCount; offset += chunkSize )
+    {
+        auto count = std::min( chunkSize, elementCount - offset );
+
+        auto& slot = this->AcquireSlot();
+        this->DrainSlot( slot, drain );
+
+        this->ReserveBuffers( slot.binding, chunkSize );
+        fill( slot.binding.input, offset, count );
+        slot.binding.input.Flush( 0, count * sizeof(uint32_t) );
+        this->Submit( slot, slot.binding, static_cast<uint32_t>( count ), m_pPipeline.get() );
+
+        slot.pendingOffset = offset;
+        slot.pendingCount = count;
+        ++stats.chunkCount;
+    }
+
+    /// Reading back the chunks that are still in flight
+    for( uint32_t i = 0; i < kSlotCount; ++i )
+    {
+        auto& slot = this->AcquireSlot();
+        this->DrainSlot( slot, drain );
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    stats.seconds = std::chrono::duration<double>( end - start ).count();
+
+    auto bytes = static_cast<double>( elementCount ) * ( sizeof(uint32_t) + sizeof(float) );
+    stats.gigabytesPerSecond = stats.seconds > 0.0 ? bytes / stats.seconds * 1e-9 : 0.0;
+    stats.dispatchSeconds = this->FinishTimings( name, profilerStart ).dispatchSeconds;
+
+    return stats;
+}
+
+void Engine::SetMemoryStrategy( MemoryStrategy strategy )
+{
+    if( !m_pDevice )
+        return;     // Nothing to allocate on the CPU backend
+
+    bool deviceLocal = strategy == MemoryStrategy::eDeviceLocal;
+    if( strategy == MemoryStrategy::eAuto )
+    {
+        // On integrated GPU (and CPU implementation) the host-visible memory is the device memory,
+        // the staging copy would only cost bandwidth
+        deviceLocal = m_physicalDevice.getProperties().deviceType == vk::PhysicalDeviceType::eDiscreteGpu;
+    }
+
+    if( deviceLocal == m_binding.deviceLocal )
+        return;
+
+    // Re-allocated with the new memory type by the next Compute()
+    this->DestroyBuffers( m_binding );
+    m_binding.deviceLocal = deviceLocal;
+}
+
+void Engine::Upload( const Buffer& dst, size_t dstOffset, const void* data, size_t size )
 {
-    this->InitializeVulkanBase();
+    this->Upload( dst.GetRange(), dstOffset, data, size );
+}
 
-    this->CreatePipelineLayout();
-    this->CreatePipeline();
+void Engine::Upload( const BufferRange& dst, size_t dstOffset, const void* data, size_t size )
+{
+    this->RequireGpu();
 
-    this->CreateDescriptorPool();
-    this->AllocateDescriptorSet();
+    if( dst.pMapped != nullptr )
+    {
+        memcpy( static_cast<char*>( dst.pMapped ) + dstOffset, data, size );
+        m_allocator.flushAllocation( dst.allocation, dst.offset + dstOffset, size );
+        return;
+    }
 
-    this->AllocateBuffers( sizeof(inputData), sizeof(outputData) );
+    this->ReserveStaging();
+    this->WaitStaging();    // The ring may still be read by the last uploads
 
-    this->PrepareCommandPool();
-    this->PrepareCommandBuffer();
+    auto src = static_cast<const char*>( data );
+    while( size > 0 )
+    {
+        auto chunkSize = std::min( size, m_uploadRing.GetSize() );
+        auto staging = m_uploadRing.Allocate( chunkSize );
+        if( !staging )
+        {
+            this->FlushTransfers();     // Recycling the ring
+            staging = m_uploadRing.Allocate( chunkSize );
+        }
+
+        memcpy( staging->pMapped, src, chunkSize );
+        m_allocator.flushAllocation( staging->allocation, staging->offset, chunkSize );
+        m_uploadCopies.push_back( { dst.buffer, vk::BufferCopy{ staging->offset, dst.offset + dstOffset, chunkSize } } );
+
+        src += chunkSize;
+        dstOffset += chunkSize;
+        size -= chunkSize;
+    }
 }
 
-Engine::~Engine()
+void Engine::Download( const Buffer& src, size_t srcOffset, void* data, size_t size )
 {
-    m_delQueue.flush();
+    this->Download( src.GetRange(), srcOffset, data, size );
 }
 
-int Engine::Compute()
+void Engine::Download( const BufferRange& src, size_t srcOffset, void* data, size_t size )
 {
-    /// Before doing computing
+    this->RequireGpu();
+
+    if( src.pMapped != nullptr )
+    {
+        m_downloads.push_back( { src, srcOffset, data, size } );
+        return;
+    }
+
+    this->ReserveStaging();
+    this->WaitStaging();
+
+    auto dst = static_cast<char*>( data );
+    while( size > 0 )
     {
-        for( int i = 0; i < 1000; ++i )
+        auto chunkSize = std::min( size, m_readbackRing.GetSize() );
+        auto staging = m_readbackRing.Allocate( chunkSize );
+        if( !staging )
         {
-            inputData[i] = i;
-            outputData[i] = 0;
+            this->FlushTransfers();     // Recycling the ring
+            staging = m_readbackRing.Allocate( chunkSize );
         }
-        this->CopyToBuffer( inputData, sizeof(inputData), m_inputBuffer );
+
+        m_downloadCopies.push_back( { src.buffer, vk::BufferCopy{ src.offset + srcOffset, staging->offset, chunkSize } } );
+        m_downloads.push_back( { *staging, 0, dst, chunkSize } );
+
+        dst += chunkSize;
+        srcOffset += chunkSize;
+        size -= chunkSize;
     }
+}
 
-    auto pFence = m_pDevice->createFenceUnique( vk::FenceCreateInfo{} );
+void Engine::FlushTransfers()
+{
+    this->FlushTransfersAround( {} );
+}
 
-    auto si = vk::SubmitInfo{};
-    si.setCommandBuffers( m_pCmdBuffer.get() );
-    m_computeQueue.submit( si, pFence.get() );
+void Engine::FlushTransfersAround( const std::function<void( vk::CommandBuffer )>& recordDispatch )
+{
+    bool hasUploads = !m_uploadCopies.empty();
+    bool hasDownloads = !m_downloadCopies.empty();
 
-    auto result = m_pDevice->waitForFences( pFence.get(), true, UINT64_MAX );
-    if( result != vk::Result::eSuccess )
+    // Profiled copies stay on the compute queue, where the timestamp queries are reset
+    if( ( hasUploads || hasDownloads ) && m_pTransferQueue != m_pComputeQueue && !m_profiling )
     {
-        throw std::runtime_error("Failed to wait fence");
-    }
+        this->WaitTimeline( *m_pTransferQueue, m_copyValue );   // Both copy command buffers are free after it
+
+        auto beginInfo = vk::CommandBufferBeginInfo{};
+        beginInfo.setFlags( vk::CommandBufferUsageFlagBits::eOneTimeSubmit );
+        if( !recordDispatch )
+        {
+            auto cmdBuffer = m_pCopyCmdBuffer.get();
+            cmdBuffer.reset();
+            cmdBuffer.begin( beginInfo );
+            this->RecordTransfers( cmdBuffer, false );
+            cmdBuffer.end();
+
+            // Downloads read what the dispatches submitted so far write. Uploads alone overlap them and are
+            // not waited: the next dispatches wait for them on the GPU, the ring and the command buffer
+            // before they are used again.
+            m_copyValue = this->SubmitTimeline( *m_pTransferQueue, cmdBuffer, hasDownloads ? m_pComputeQueue : nullptr );
+            if( hasDownloads )
+                this->WaitTimeline( *m_pTransferQueue, m_copyValue );
+        }
+        else
+        {
+            // Uploads, then the dispatch waiting for them on the GPU, then the downloads waiting for the dispatch
+            if( hasUploads )
+            {
+                auto cmdBuffer = m_pCopyCmdBuffer.get();
+                cmdBuffer.reset();
+                cmdBuffer.begin( beginInfo );
+                this->RecordCopies( cmdBuffer, true );
+                cmdBuffer.end();
+                m_copyValue = this->SubmitTimeline( *m_pTransferQueue, cmdBuffer );
+            }
+
+            auto cmdBuffer = this->BeginImmediate();
+            recordDispatch( cmdBuffer );
+            cmdBuffer.end();
+            m_immediateValue = this->SubmitTimeline( *m_pComputeQueue, cmdBuffer, m_pTransferQueue );
 
-    /// After doing computing
+            if( hasDownloads )
+            {
+                auto downloadCmdBuffer = m_pDownloadCmdBuffer.get();
+                downloadCmdBuffer.reset();
+                downloadCmdBuffer.begin( beginInfo );
+                this->RecordCopies( downloadCmdBuffer, false );
+                auto barrier = vk::MemoryBarrier{};
+                barrier.setSrcAccessMask( vk::AccessFlagBits::eTransferWrite );
+                barrier.setDstAccessMask( vk::AccessFlagBits::eHostRead );
+                downloadCmdBuffer.pipelineBarrier( vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+                                                   vk::DependencyFlags{}, barrier, nullptr, nullptr );
+                downloadCmdBuffer.end();
+                m_copyValue = this->SubmitTimeline( *m_pTransferQueue, downloadCmdBuffer, m_pComputeQueue );
+                this->WaitTimeline( *m_pTransferQueue, m_copyValue );
+            }
+            else
+            {
+                this->WaitTimeline( *m_pComputeQueue, m_immediateValue );
+            }
+        }
+    }
+    else if( hasUploads || hasDownloads || recordDispatch )
     {
-        this->CopyFromBuffer( outputData, sizeof(outputData), m_outputBuffer ); // Copying compute's result
-        for( int i = 0; i < 1000; i += 50 )
+        auto cmdBuffer = this->BeginImmediate();
+        this->RecordTransfers( cmdBuffer, true, recordDispatch );
+        cmdBuffer.end();
+
+        auto submitSeconds = m_profiler.Now();
+        m_immediateValue = this->SubmitTimeline( *m_pComputeQueue, cmdBuffer, m_pTransferQueue );
+
+        // Uploads alone are not waited: the next submissions come after them on the queue, and the
+        // ring and the command buffer wait for this value before they are used again
+        if( hasDownloads || recordDispatch || m_profiling )
+            this->WaitTimeline( *m_pComputeQueue, m_immediateValue );
+
+        if( m_profiling )
         {
-            std::cout << inputData[i] << " -> " << outputData[i] << "\n";
+            if( hasUploads )
+                m_timings.uploadSeconds += m_profiler.AddGpuEvent( "upload", kTransferQueryRange, 0, 1, submitSeconds );
+            if( recordDispatch )
+            {
+                m_timings.dispatchSeconds += m_profiler.AddGpuEvent( "dispatch", kTransferQueryRange, 1, 2, submitSeconds );
+                m_timings.invocations += m_profiler.GetInvocations( kTransferQueryRange );
+            }
+            if( hasDownloads )
+                m_timings.downloadSeconds += m_profiler.AddGpuEvent( "download", kTransferQueryRange, 2, 3, submitSeconds );
         }
     }
 
-    return 0;
+    for( const auto& download : m_downloads )
+    {
+        const auto& source = download.source;
+        m_allocator.invalidateAllocation( source.allocation, source.offset + download.offset, download.size );
+        memcpy( download.data, static_cast<const char*>( source.pMapped ) + download.offset, download.size );
+    }
+
+    m_uploadCopies.clear();
+    m_downloadCopies.clear();
+    m_downloads.clear();
+    m_uploadRing.Reset();
+    m_readbackRing.Reset();
+}
+
+void Engine::RecordTransfers( vk::CommandBuffer cmdBuffer, bool onComputeQueue, const std::function<void( vk::CommandBuffer )>& recordDispatch ) const
+{
+    if( m_profiling )
+    {
+        m_profiler.CmdReset( cmdBuffer, kTransferQueryRange );
+        m_profiler.CmdTimestamp( cmdBuffer, kTransferQueryRange, 0, vk::PipelineStageFlagBits::eTopOfPipe );
+    }
+
+    /// Earlier dispatches have to finish with the buffers before they are read or overwritten (on the
+    /// transfer queue, the timeline wait of the submission orders them)
+    if( onComputeQueue )
+    {
+        auto barrier = vk::MemoryBarrier{};
+        barrier.setSrcAccessMask( vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite );
+        barrier.setDstAccessMask( vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite );
+        cmdBuffer.pipelineBarrier( vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer,
+                                   vk::DependencyFlags{}, barrier, nullptr, nullptr );
+    }
+
+    this->RecordCopies( cmdBuffer, true );
+    if( m_profiling )
+        m_profiler.CmdTimestamp( cmdBuffer, kTransferQueryRange, 1, vk::PipelineStageFlagBits::eTransfer );
+
+    /// The dispatch reads the uploads, the downloads read what it writes
+    if( recordDispatch )
+    {
+        auto barrier = vk::MemoryBarrier{};
+        barrier.setSrcAccessMask( vk::AccessFlagBits::eTransferWrite );
+        barrier.setDstAccessMask( vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite );
+        cmdBuffer.pipelineBarrier( vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader,
+                                   vk::DependencyFlags{}, barrier, nullptr, nullptr );
+
+        if( m_profiling )
+            m_profiler.CmdBeginStatistics( cmdBuffer, kTransferQueryRange );
+        recordDispatch( cmdBuffer );
+        if( m_profiling )
+            m_profiler.CmdEndStatistics( cmdBuffer, kTransferQueryRange );
+
+        ShaderWriteBarrier( cmdBuffer, vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eHost,
+                            vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eHostRead );    // Mapped outputs are read in place
+    }
+    if( m_profiling )
+        m_profiler.CmdTimestamp( cmdBuffer, kTransferQueryRange, 2, vk::PipelineStageFlagBits::eComputeShader );
+
+    this->RecordCopies( cmdBuffer, false );
+    if( m_profiling )
+        m_profiler.CmdTimestamp( cmdBuffer, kTransferQueryRange, 3, vk::PipelineStageFlagBits::eTransfer );
+
+    /// The copied data is visible for the next dispatches and for the host
+    if( onComputeQueue )
+    {
+        auto barrier = vk::MemoryBarrier{};
+        barrier.setSrcAccessMask( vk::AccessFlagBits::eTransferWrite );
+        barrier.setDstAccessMask( vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eHostRead );
+        cmdBuffer.pipelineBarrier( vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eHost,
+                                   vk::DependencyFlags{}, barrier, nullptr, nullptr );
+    }
+    else
+    {
+        auto barrier = vk::MemoryBarrier{};
+        barrier.setSrcAccessMask( vk::AccessFlagBits::eTransferWrite );
+        barrier.setDstAccessMask( vk::AccessFlagBits::eHostRead );
+        cmdBuffer.pipelineBarrier( vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+                                   vk::DependencyFlags{}, barrier, nullptr, nullptr );
+    }
+}
+
+void Engine::RecordCopies( vk::CommandBuffer cmdBuffer, bool uploads ) const
+{
+    const auto& copies = uploads ? m_uploadCopies : m_downloadCopies;
+    auto staging = uploads ? m_uploadRing.GetBuffer().GetBuffer() : m_readbackRing.GetBuffer().GetBuffer();
+
+    std::vector<vk::BufferCopy> regions;
+    for( size_t i = 0; i < copies.size(); ++i )
+    {
+        regions.push_back( copies[i].region );
+        if( i + 1 < copies.size() && copies[i + 1].buffer == copies[i].buffer )
+            continue;
+
+        if( uploads )
+            cmdBuffer.copyBuffer( staging, copies[i].buffer, regions );
+        else
+            cmdBuffer.copyBuffer( copies[i].buffer, staging, regions );
+        regions.clear();
+    }
+}
+
+void Engine::WaitStaging() const
+{
+    this->WaitTimeline( *m_pComputeQueue, m_immediateValue );
+    this->WaitTimeline( *m_pTransferQueue, m_copyValue );
+}
+
+void Engine::ReserveStaging()
+{
+    if( m_uploadRing.GetSize() != 0 )
+        return;
+
+    auto usage = vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst;
+    m_uploadRing = LinearArena( m_allocator, kStagingRingSize, usage, BufferIntent::eUpload );
+    m_readbackRing = LinearArena( m_allocator, kStagingRingSize, usage, BufferIntent::eReadback );
 }
 
-void Engine::InitializeVulkanBase()
+void Engine::InitializeVulkanBase( uint32_t deviceIndex )
 {
     //// Instance and Debug Utils Messenger
     {
@@ -94,119 +1550,709 @@ void Engine::InitializeVulkanBase()
         );
         debugUtilsInfo.setPfnUserCallback( debugutils::debugUtilsMessengerCallback );
 
-        /// The Validation Layers
+        /// The Validation Layers and the extensions, only the ones that are installed (none on a node
+        /// without the SDK)
         auto instanceLayers = vk::enumerateInstanceLayerProperties();
-        auto validationLayers = this->InstanceValidations();
-        std::vector<const char*> enableValidationLayers;
-        enableValidationLayers.reserve( validationLayers.size() );
-        for( const auto& layer : validationLayers )
+        for( const auto& layer : this->InstanceValidations() )
+        {
+            auto found = std::find_if( instanceLayers.begin(), instanceLayers.end(),
+                                [&layer]( const vk::LayerProperties& l ){ return strcmp( l.layerName, layer ) == 0; }
+            );
+            if( found != instanceLayers.end() )
+                m_validationLayers.push_back( layer );
+        }
+
+        auto instanceExtensions = vk::enumerateInstanceExtensionProperties();
+        std::vector<const char*> enabledExtensions;
+        bool debugUtils = false;
+        for ( const auto& extension : this->InstanceExtensions() )
+        {
+            auto found = std::find_if( instanceExtensions.begin(), instanceExtensions.end(),
+                            [&extension]( const vk::ExtensionProperties& ext ){ return strcmp( ext.extensionName, extension ) == 0; }
+            );
+            if( found == instanceExtensions.end() )
+                continue;
+            enabledExtensions.push_back( extension );
+            debugUtils |= strcmp( extension, VK_EXT_DEBUG_UTILS_EXTENSION_NAME ) == 0;
+        }
+
+        /// Instance create info
+        vk::InstanceCreateInfo instanceInfo {};
+        if( debugUtils )
+            instanceInfo.setPNext( reinterpret_cast<VkDebugUtilsMessengerCreateInfoEXT*>( &debugUtilsInfo ) );
+        instanceInfo.setPApplicationInfo( &appInfo );
+        instanceInfo.setPEnabledLayerNames( m_validationLayers );
+        instanceInfo.setPEnabledExtensionNames( enabledExtensions );
+
+        /// Creating instance and debugutils
+        try
+        {
+            m_pInstance = vk::createInstanceUnique( instanceInfo );
+        }
+        catch( const vk::SystemError& )
+        {
+            return;     // No driver, or one that refuses the instance: same as no device
+        }
+        if( debugUtils )
+        {
+            VkDebugUtilsMessengerEXT dbgUtils;
+            debugutils::CreateDebugUtilsMessengerEXT( 
+                static_cast<VkInstance>( m_pInstance.get() ), 
+                reinterpret_cast<VkDebugUtilsMessengerCreateInfoEXT*>(&debugUtilsInfo), 
+                nullptr, &dbgUtils
+            );
+
+            m_debugUtils = static_cast<vk::DebugUtilsMessengerEXT>( dbgUtils );
+            m_delQueue.push( DestroyOp::eDebugMessenger, DeletionQueue::kAtShutdown, static_cast<VkInstance>( m_pInstance.get() ), dbgUtils );
+        }
+    }
+
+    //// Pick Physical Device and Create Device
+    {
+        m_physicalDevice = this->PickPhysicalDevice( deviceIndex );
+        if( !m_physicalDevice )
+            return;     // No compute-capable device (or not that many), the engine runs on the CPU backend
+        {
+            auto features = m_physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan11Features, vk::PhysicalDeviceVulkan12Features>();
+            const auto& vulkan11Features = features.get<vk::PhysicalDeviceVulkan11Features>();
+            const auto& vulkan12Features = features.get<vk::PhysicalDeviceVulkan12Features>();
+            m_bufferDeviceAddress = vulkan12Features.bufferDeviceAddress;
+            m_bindless = m_bufferDeviceAddress;
+
+            // VK_KHR_16bit_storage and VK_KHR_8bit_storage are core since Vulkan 1.1 and 1.2, only the features are optional
+            m_storage16Bit = vulkan11Features.storageBuffer16BitAccess;
+            m_storage8Bit = vulkan12Features.storageBuffer8BitAccess;
+            m_shaderFloat16 = vulkan12Features.shaderFloat16;
+            m_shaderInt8 = vulkan12Features.shaderInt8;
+        }
+        m_pDevice = this->CreateDevice();
+        auto limits = m_physicalDevice.getProperties().limits;
+        m_maxGroupCountX = limits.maxComputeWorkGroupCount[0];
+        m_maxGroupSizeX = limits.maxComputeWorkGroupSize[0];
+        m_maxGroupInvocations = limits.maxComputeWorkGroupInvocations;
+        m_timestampPeriod = limits.timestampPeriod;
+        m_storageAlignment = static_cast<size_t>( limits.minStorageBufferOffsetAlignment );
+        m_budgetHeaps = { this->FindBudgetHeap( false ), this->FindBudgetHeap( true ) };
+
+        if( this->IsDeviceExtensionSupported( VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME ) )
+        {
+            auto props = m_physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceExternalMemoryHostPropertiesEXT>();
+            m_hostImportAlignment = props.get<vk::PhysicalDeviceExternalMemoryHostPropertiesEXT>().minImportedHostPointerAlignment;
+        }
+
+        // Core since Vulkan 1.1, a local size that is not a multiple of it leaves lanes idle
+        {
+            auto props = m_physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceSubgroupProperties>();
+            const auto& subgroup = props.get<vk::PhysicalDeviceSubgroupProperties>();
+            m_subgroupSize = std::max( subgroup.subgroupSize, 1u );
+
+            // The library kernels need a power of two local size (shared memory trees), and with
+            // subgroup arithmetic, full subgroups
+            m_libraryLocalSize = 1;
+            while( m_libraryLocalSize * 2 <= std::min( { 256u, m_maxGroupSizeX, m_maxGroupInvocations } ) )
+                m_libraryLocalSize *= 2;
+            m_subgroupArithmetic = ( subgroup.supportedOperations & vk::SubgroupFeatureFlagBits::eArithmetic ) &&
+                                   ( subgroup.supportedStages & vk::ShaderStageFlagBits::eCompute ) &&
+                                   m_libraryLocalSize % m_subgroupSize == 0;
+        }
+
+        /// The queues created by CreateDevice(), every one with its timeline starting from 0 (nothing submitted)
+        auto families = *FindQueueFamilies( m_physicalDevice );
+        auto initQueue = [this]( DeviceQueue& queue, uint32_t family, uint32_t index ){
+            auto timelineInfo = vk::SemaphoreTypeCreateInfo{};
+            timelineInfo.setSemaphoreType( vk::SemaphoreType::eTimeline );
+            timelineInfo.setInitialValue( 0 );
+            auto semaphoreInfo = vk::SemaphoreCreateInfo{};
+            semaphoreInfo.setPNext( &timelineInfo );
+
+            queue.queue = m_pDevice->getQueue( family, index );
+            queue.family = family;
+            queue.timeline = m_pDevice->createSemaphoreUnique( semaphoreInfo );
+        };
+        initQueue( m_queues[0], families.compute, 0 );
+        if( families.computeCount > 1 )
+        {
+            initQueue( m_queues[1], families.compute, 1 );
+            m_pAsyncQueue = &m_queues[1];
+        }
+        if( families.transfer )
+        {
+            initQueue( m_queues[2], *families.transfer, 0 );
+            m_pTransferQueue = &m_queues[2];
+        }
+        m_timestampValidBits = m_physicalDevice.getQueueFamilyProperties()[families.compute].timestampValidBits;
+    }
+
+    /// Allocator from VMA
+    {
+        auto allocatorInfo = vma::AllocatorCreateInfo{};
+        allocatorInfo.setInstance( m_pInstance.get() );
+        allocatorInfo.setDevice( m_pDevice.get() );
+        allocatorInfo.setPhysicalDevice( m_physicalDevice );
+        allocatorInfo.setVulkanApiVersion( VK_API_VERSION_1_3 );
+        auto flags = vma::AllocatorCreateFlags{};
+        if( m_bufferDeviceAddress )
+            flags |= vma::AllocatorCreateFlagBits::eBufferDeviceAddress;
+        if( this->IsDeviceExtensionSupported( VK_EXT_MEMORY_BUDGET_EXTENSION_NAME ) )
+            flags |= vma::AllocatorCreateFlagBits::eExtMemoryBudget;    // Usage of every process, from the driver (GetMemoryBudget())
+        allocatorInfo.setFlags( flags );
+        m_allocator = vma::createAllocator( allocatorInfo );
+        m_delQueue.push( DestroyOp::eAllocator, DeletionQueue::kAtShutdown, static_cast<VmaAllocator>( m_allocator ) );
+    }
+}
+
+void Engine::PrepareCommandPool()
+{
+    vk::CommandPoolCreateInfo poolInfo {};
+    poolInfo.setQueueFamilyIndex( m_pComputeQueue->family );
+    poolInfo.setFlags( vk::CommandPoolCreateFlagBits::eResetCommandBuffer );
+
+    m_pCmdPool = m_pDevice->createCommandPoolUnique( poolInfo );
+
+    if( m_pTransferQueue != m_pComputeQueue )
+    {
+        poolInfo.setQueueFamilyIndex( m_pTransferQueue->family );
+        m_pCopyCmdPool = m_pDevice->createCommandPoolUnique( poolInfo );
+    }
+}
+
+void Engine::PrepareCommandBuffer()
+{
+    auto allocInfo = vk::CommandBufferAllocateInfo{};
+    allocInfo.setCommandPool( m_pCmdPool.get() );
+    allocInfo.setLevel( vk::CommandBufferLevel::ePrimary );
+    allocInfo.setCommandBufferCount( kSlotCount );
+    auto cmdBuffers = m_pDevice->allocateCommandBuffersUnique( allocInfo );
+
+    m_slots.resize( kSlotCount );
+    for( uint32_t i = 0; i < kSlotCount; ++i )
+    {
+        m_slots[i].cmdBuffer = std::move( cmdBuffers[i] );
+        m_slots[i].queryRange = i;
+    }
+
+    /// The one-shot jobs of the kernel library and graphs (and the staging copies without a transfer queue)
+    allocInfo.setCommandBufferCount( 1 );
+    m_pImmediateCmdBuffer = std::move( m_pDevice->allocateCommandBuffersUnique( allocInfo ).front() );
+
+    /// The staging copies on the transfer queue
+    if( m_pCopyCmdPool )
+    {
+        allocInfo.setCommandPool( m_pCopyCmdPool.get() );
+        m_pCopyCmdBuffer = std::move( m_pDevice->allocateCommandBuffersUnique( allocInfo ).front() );
+        m_pDownloadCmdBuffer = std::move( m_pDevice->allocateCommandBuffersUnique( allocInfo ).front() );
+    }
+}
+
+Engine::Slot& Engine::AcquireSlot()
+{
+    auto& slot = m_slots[m_slotIndex];
+    m_slotIndex = ( m_slotIndex + 1 ) % m_slots.size();
+
+    this->WaitTimeline( *m_pComputeQueue, slot.submittedValue );
+    this->CollectTimings( slot );
+
+    this->CollectGarbage();
+
+    return slot;
+}
+
+uint64_t Engine::GetCompletedValue( const DeviceQueue& queue ) const
+{
+    return m_pDevice->getSemaphoreCounterValue( queue.timeline.get() );
+}
+
+uint64_t Engine::SubmitTimeline( DeviceQueue& queue, vk::CommandBuffer cmdBuffer, const DeviceQueue* pWaitQueue )
+{
+    // The other queue runs in parallel, its memory accesses are ordered by the timeline wait
+    std::vector<vk::Semaphore> waitSemaphores;
+    std::vector<uint64_t> waitValues;
+    std::vector<vk::PipelineStageFlags> waitStages;
+    if( pWaitQueue && pWaitQueue != &queue )
+    {
+        uint64_t waitValue = pWaitQueue->submittedValue;
+        if( waitValue > this->GetCompletedValue( *pWaitQueue ) )
+        {
+            waitSemaphores.push_back( pWaitQueue->timeline.get() );
+            waitValues.push_back( waitValue );
+            waitStages.push_back( vk::PipelineStageFlagBits::eAllCommands );
+        }
+    }
+
+    // The values have to be signaled in increasing order, so taking one and submitting go together
+    std::lock_guard<std::mutex> lock( queue.mutex );
+    uint64_t value = queue.submittedValue + 1;
+
+    auto timelineInfo = vk::TimelineSemaphoreSubmitInfo{};
+    timelineInfo.setWaitSemaphoreValues( waitValues );
+    timelineInfo.setSignalSemaphoreValues( value );
+    auto si = vk::SubmitInfo{};
+    si.setPNext( &timelineInfo );
+    si.setWaitSemaphores( waitSemaphores );
+    si.setWaitDstStageMask( waitStages );
+    si.setCommandBuffers( cmdBuffer );
+    si.setSignalSemaphores( queue.timeline.get() );
+    queue.queue.submit( si );
+
+    queue.submittedValue = value;
+    return value;
+}
+
+void Engine::WaitTimeline( const DeviceQueue& queue, uint64_t value ) const
+{
+    if( value == 0 || this->GetCompletedValue( queue ) >= value )
+        return;
+
+    auto waitInfo = vk::SemaphoreWaitInfo{};
+    waitInfo.setSemaphores( queue.timeline.get() );
+    waitInfo.setValues( value );
+    auto result = m_pDevice->waitSemaphores( waitInfo, UINT64_MAX );
+    if( result != vk::Result::eSuccess )
+    {
+        throw std::runtime_error("Failed to wait timeline semaphore");
+    }
+}
+
+std::vector<uint32_t> Engine::SharedQueueFamilies() const
+{
+    // Concurrent sharing instead of ownership transfers: the copies and the dispatches of a buffer are
+    // not paired, and buffers are not affected by the layouts that make it costly for images
+    if( m_pTransferQueue->family == m_pComputeQueue->family )
+        return {};
+    return { m_pComputeQueue->family, m_pTransferQueue->family };
+}
+
+void Engine::CollectGarbage()
+{
+    if( m_delQueue.empty() )
+        return;
+
+    // The values are of the compute queue, the copies still running on the transfer queue may use
+    // what was freed before them
+    if( m_copyValue > this->GetCompletedValue( *m_pTransferQueue ) )
+        return;
+
+    m_delQueue.retire( this->GetCompletedValue( *m_pComputeQueue ) );
+}
+
+uint64_t Engine::GetLastTicket() const
+{
+    return m_pComputeQueue->submittedValue;
+}
+
+bool Engine::IsComplete( uint64_t ticket ) const
+{
+    this->RequireGpu();
+    return this->GetCompletedValue( *m_pComputeQueue ) >= ticket;
+}
+
+void Engine::Wait( uint64_t ticket ) const
+{
+    this->RequireGpu();
+    if( ticket > m_pComputeQueue->submittedValue )
+        throw std::runtime_error("Waiting for a ticket that has not been submitted");
+    this->WaitTimeline( *m_pComputeQueue, ticket );
+}
+
+void Engine::StartAsync()
+{
+    vk::CommandPoolCreateInfo poolInfo {};
+    poolInfo.setQueueFamilyIndex( m_pAsyncQueue->family );
+    poolInfo.setFlags( vk::CommandPoolCreateFlagBits::eResetCommandBuffer );
+    m_pAsyncCmdPool = m_pDevice->createCommandPoolUnique( poolInfo );
+
+    auto cmdBufferInfo = vk::CommandBufferAllocateInfo{};
+    cmdBufferInfo.setCommandPool( m_pAsyncCmdPool.get() );
+    cmdBufferInfo.setLevel( vk::CommandBufferLevel::ePrimary );
+    cmdBufferInfo.setCommandBufferCount( kAsyncBatchCount );
+    auto cmdBuffers = m_pDevice->allocateCommandBuffersUnique( cmdBufferInfo );
+
+    // Two storage buffers for each job
+    std::vector<vk::DescriptorPoolSize> poolSizes {
+        { vk::DescriptorType::eStorageBuffer, kAsyncBatchSize * 2 }
+    };
+    auto descPoolInfo = vk::DescriptorPoolCreateInfo{};
+    descPoolInfo.setPoolSizes( poolSizes );
+    descPoolInfo.setMaxSets( kAsyncBatchSize );
+
+    m_asyncBatches.resize( kAsyncBatchCount );
+    for( uint32_t i = 0; i < kAsyncBatchCount; ++i )
+    {
+        auto& batch = m_asyncBatches[i];
+        batch.cmdBuffer = std::move( cmdBuffers[i] );
+        batch.descPool = m_pDevice->createDescriptorPoolUnique( descPoolInfo );
+        batch.jobs.reserve( kAsyncBatchSize );
+        m_asyncFree.push_back( &batch );
+    }
+
+    m_submitThread = std::thread( &Engine::SubmitLoop, this );
+    m_waitThread = std::thread( &Engine::WaitLoop, this );
+}
+
+void Engine::StopAsync()
+{
+    if( !m_submitThread.joinable() )
+        return;
+
+    m_asyncStopping.store( true );
+    m_asyncPushed.fetch_add( 1, std::memory_order_release );
+    m_asyncPushed.notify_one();
+    m_submitThread.join();
+    m_waitThread.join();
+}
+
+void Engine::SubmitLoop()
+{
+    while( true )
+    {
+        // Read before popping, a push that comes after the pop changes it and ends the wait
+        auto pushed = m_asyncPushed.load( std::memory_order_acquire );
+        auto job = m_asyncJobs.Pop();
+        if( !job )
+        {
+            if( m_asyncStopping.load() )    // No more producers, the queue is empty
+                break;
+            m_asyncPushed.wait( pushed, std::memory_order_acquire );
+            continue;
+        }
+
+        AsyncBatch* pBatch = nullptr;
+        {
+            std::unique_lock<std::mutex> lock( m_asyncMutex );
+            m_asyncCondition.wait( lock, [this](){ return !m_asyncFree.empty(); } );
+            pBatch = m_asyncFree.front();
+            m_asyncFree.pop_front();
+        }
+
+        // Every job queued meanwhile goes into the same submission
+        pBatch->jobs.push_back( std::move( *job ) );
+        while( pBatch->jobs.size() < kAsyncBatchSize )
+        {
+            auto next = m_asyncJobs.Pop();
+            if( !next )
+                break;
+            pBatch->jobs.push_back( std::move( *next ) );
+        }
+
+        try
+        {
+            this->RecordBatch( *pBatch );
+            pBatch->submittedValue = this->SubmitTimeline( *m_pAsyncQueue, pBatch->cmdBuffer.get(), m_pTransferQueue );
+        }
+        catch( ... )
+        {
+            for( auto& failed : pBatch->jobs )
+                failed.promise.set_exception( std::current_exception() );
+            pBatch->jobs.clear();
+
+            std::lock_guard<std::mutex> lock( m_asyncMutex );
+            m_asyncFree.push_back( pBatch );
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock( m_asyncMutex );
+            m_asyncInFlight.push_back( pBatch );
+        }
+        m_asyncCondition.notify_all();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( m_asyncMutex );
+        m_asyncSubmitDone = true;
+    }
+    m_asyncCondition.notify_all();
+}
+
+void Engine::WaitLoop()
+{
+    while( true )
+    {
+        AsyncBatch* pBatch = nullptr;
         {
-            auto found = std::find_if( instanceLayers.begin(), instanceLayers.end(),
-                                [&layer]( const vk::LayerProperties& l ){ return strcmp( l.layerName, layer ); }
-            );
-            assert( found != instanceLayers.end() );
-            enableValidationLayers.push_back( layer );
+            std::unique_lock<std::mutex> lock( m_asyncMutex );
+            m_asyncCondition.wait( lock, [this](){ return !m_asyncInFlight.empty() || m_asyncSubmitDone; } );
+            if( m_asyncInFlight.empty() )
+                break;
+            pBatch = m_asyncInFlight.front();  // In order, as the timeline
         }
 
-        auto instanceExtensions = vk::enumerateInstanceExtensionProperties();
-        auto enabledExtensions = this->InstanceExtensions();    // Assume that the extensions is available
-        for ( const auto& extension : enabledExtensions )
+        try
         {
-            auto found = std::find_if( instanceExtensions.begin(), instanceExtensions.end(),
-                            [&extension]( const vk::ExtensionProperties& ext ){ return strcmp( ext.extensionName, extension ) == 0; }
-            );
-            assert( found != instanceExtensions.end() );
+            this->WaitTimeline( *m_pAsyncQueue, pBatch->submittedValue );
+            for( auto& job : pBatch->jobs )
+                job.promise.set_value();
+        }
+        catch( ... )
+        {
+            for( auto& job : pBatch->jobs )
+                job.promise.set_exception( std::current_exception() );
         }
+        pBatch->jobs.clear();
 
-        /// Instance create info
-        vk::InstanceCreateInfo instanceInfo {};
-        instanceInfo.setPNext( reinterpret_cast<VkDebugUtilsMessengerCreateInfoEXT*>( &debugUtilsInfo ) );
-        instanceInfo.setPApplicationInfo( &appInfo );
-        instanceInfo.setPEnabledLayerNames( enableValidationLayers );
-        instanceInfo.setPEnabledExtensionNames( enabledExtensions );
+        {
+            std::lock_guard<std::mutex> lock( m_asyncMutex );
+            m_asyncInFlight.pop_front();
+            m_asyncFree.push_back( pBatch );
+        }
+        m_asyncCondition.notify_all();
+    }
+}
 
-        /// Creating instance and debugutils
-        m_pInstance = vk::createInstanceUnique( instanceInfo );
-        VkDebugUtilsMessengerEXT dbgUtils;
-        debugutils::CreateDebugUtilsMessengerEXT( 
-            static_cast<VkInstance>( m_pInstance.get() ), 
-            reinterpret_cast<VkDebugUtilsMessengerCreateInfoEXT*>(&debugUtilsInfo), 
-            nullptr, &dbgUtils
-        );
+void Engine::RecordBatch( AsyncBatch& batch )
+{
+    const auto& jobs = batch.jobs;
 
-        m_debugUtils = static_cast<vk::DebugUtilsMessengerEXT>( dbgUtils );
-        m_delQueue.pushFunction( [i=m_pInstance.get(), d=m_debugUtils, f=debugutils::DestroyDebugUtilsMessengerEXT](){
-            f( static_cast<VkInstance>( i ), static_cast<VkDebugUtilsMessengerEXT>( d ), nullptr );
-        });
+    /// A set for each job that is not bindless
+    std::vector<vk::DescriptorSet> sets( jobs.size() );
+    std::vector<size_t> boundJobs;
+    for( size_t j = 0; j < jobs.size(); ++j )
+    {
+        if( !this->UseBindless( jobs[j].input, jobs[j].output ) )
+            boundJobs.push_back( j );
+    }
+    m_pDevice->resetDescriptorPool( batch.descPool.get() );
+    if( !boundJobs.empty() )
+    {
+        std::vector<vk::DescriptorSetLayout> setLayouts( boundJobs.size(), m_pSetLayout.get() );
+        auto setAllocateInfo = vk::DescriptorSetAllocateInfo{};
+        setAllocateInfo.setDescriptorPool( batch.descPool.get() );
+        setAllocateInfo.setSetLayouts( setLayouts );
+        auto allocated = m_pDevice->allocateDescriptorSets( setAllocateInfo );
+        for( size_t i = 0; i < boundJobs.size(); ++i )
+            sets[boundJobs[i]] = allocated[i];
     }
 
-    //// Pick Physical Device and Create Device
+    /// The jobs as the stages of a graph, for the waves: the ones that touch the same memory stay in order
+    ComputeGraph graph;
+    for( size_t j = 0; j < jobs.size(); ++j )
     {
-        m_physicalDevice = this->PickPhysicalDevice( m_queueFlags );
-        m_pDevice = this->CreateDevice();
+        graph.AddStage( graph.AddBuffer( jobs[j].input ), graph.AddBuffer( jobs[j].output ), jobs[j].elementCount );
+        if( !sets[j] )
+            continue;
 
-        auto queueFam = FindQueueFamilyIndices( m_physicalDevice, m_queueFlags );
-        vk::DeviceQueueInfo2 qi = {};
+        std::array<vk::DescriptorBufferInfo, 2> descriptorBufferInfos {
+            vk::DescriptorBufferInfo{ jobs[j].input.buffer, jobs[j].input.offset, jobs[j].input.size },
+            vk::DescriptorBufferInfo{ jobs[j].output.buffer, jobs[j].output.offset, jobs[j].output.size },
+        };
+        auto writeDescriptorSet = vk::WriteDescriptorSet{};
+        writeDescriptorSet.setBufferInfo( descriptorBufferInfos );
+        writeDescriptorSet.setDescriptorType( vk::DescriptorType::eStorageBuffer );
+        writeDescriptorSet.setDstSet( sets[j] );
+        writeDescriptorSet.setDstBinding( 0 );
+        m_pDevice->updateDescriptorSets( writeDescriptorSet, nullptr );
+    }
+    auto plan = graph.Compile( m_storageAlignment );
+
+    auto cmdBuffer = batch.cmdBuffer.get();
+    auto beginInfo = vk::CommandBufferBeginInfo{};
+    beginInfo.setFlags( vk::CommandBufferUsageFlagBits::eOneTimeSubmit );
+    cmdBuffer.reset();
+    cmdBuffer.begin( beginInfo );
+    for( const auto& wave : plan.waves )
+    {
+        ShaderWriteBarrier( cmdBuffer, vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite );
+        for( auto j : wave )
+        {
+            if( sets[j] )
+                this->RecordDispatch( cmdBuffer, m_pPipeline.get(), m_kernelConfig, sets[j], jobs[j].elementCount );
+            else
+                this->RecordDispatch( cmdBuffer, m_pBindlessPipeline.get(), m_kernelConfig, jobs[j].input, jobs[j].output, jobs[j].elementCount );
+        }
+    }
+    ShaderWriteBarrier( cmdBuffer, vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eHost,
+                        vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eHostRead );
+    cmdBuffer.end();
+}
 
-        // "1" because we want queueFamily of 0 (why? because queuefaily of 0 have more queue count)
-        // In the future, maybe it coulbe be source of bug.
-        m_queueFamilyIndex = static_cast<uint32_t>(queueFam[1].value());
-        qi.setQueueFamilyIndex( m_queueFamilyIndex );
-        qi.setQueueIndex(0);
-        m_computeQueue = m_pDevice->getQueue2( qi );
+void Engine::Submit( Slot& slot, const IoBinding& binding, uint32_t elementCount, vk::Pipeline pipeline )
+{
+    if( slot.recordedSet != binding.set.get() ||
+        slot.recordedPipeline != pipeline ||
+        slot.recordedGeneration != binding.generation ||
+        slot.recordedCount != elementCount )
+    {
+        this->RecordCommandBuffer( slot, [&]( vk::CommandBuffer cmdBuffer ){
+            this->RecordDispatch( cmdBuffer, pipeline, m_kernelConfig, binding.set.get(), elementCount );
+        } );
+        slot.recordedSet = binding.set.get();
+        slot.recordedPipeline = pipeline;
+        slot.recordedGeneration = binding.generation;
+        slot.recordedInput = 0;
+        slot.recordedOutput = 0;
+        slot.recordedCount = elementCount;
     }
 
-    /// Allocator from VMA
+    this->SubmitRecorded( slot );
+}
+
+void Engine::Submit( Slot& slot, const BufferRange& input, const BufferRange& output, uint32_t elementCount )
+{
+    if( slot.recordedSet ||
+        slot.recordedInput != input.address ||
+        slot.recordedOutput != output.address ||
+        slot.recordedCount != elementCount )
     {
-        auto allocatorInfo = vma::AllocatorCreateInfo{};
-        allocatorInfo.setInstance( m_pInstance.get() );
-        allocatorInfo.setDevice( m_pDevice.get() );
-        allocatorInfo.setPhysicalDevice( m_physicalDevice );
-        allocatorInfo.setVulkanApiVersion( VK_API_VERSION_1_3 );
-        m_allocator = vma::createAllocator( allocatorInfo );
-        m_delQueue.pushFunction([a = m_allocator](){
-            a.destroy();
-        });
+        this->RecordCommandBuffer( slot, [&]( vk::CommandBuffer cmdBuffer ){
+            this->RecordDispatch( cmdBuffer, m_pBindlessPipeline.get(), m_kernelConfig, input, output, elementCount );
+        } );
+        slot.recordedSet = vk::DescriptorSet{};
+        slot.recordedPipeline = vk::Pipeline{};
+        slot.recordedGeneration = 0;
+        slot.recordedInput = input.address;
+        slot.recordedOutput = output.address;
+        slot.recordedCount = elementCount;
     }
+
+    this->SubmitRecorded( slot );
 }
 
-void Engine::PrepareCommandPool()
+void Engine::SubmitRecorded( Slot& slot )
 {
-    vk::CommandPoolCreateInfo poolInfo {};
-    poolInfo.setQueueFamilyIndex( m_queueFamilyIndex );
-    poolInfo.setFlags( vk::CommandPoolCreateFlagBits::eResetCommandBuffer );
+    slot.submitSeconds = m_profiler.Now();
+    slot.submittedValue = this->SubmitTimeline( *m_pComputeQueue, slot.cmdBuffer.get(), m_pTransferQueue );
+    slot.transientInFlight = true;
+    slot.timingPending = m_profiling;
+}
 
-    m_pCmdPool = m_pDevice->createCommandPoolUnique( poolInfo );
+void Engine::CollectTimings( Slot& slot )
+{
+    if( !slot.timingPending )
+        return;
+
+    m_timings.dispatchSeconds += m_profiler.AddGpuEvent( "dispatch", slot.queryRange, 0, 1, slot.submitSeconds );
+    m_timings.invocations += m_profiler.GetInvocations( slot.queryRange );
+    slot.timingPending = false;
 }
 
-void Engine::PrepareCommandBuffer()
+ComputeTimings Engine::FinishTimings( const char* name, double startSeconds )
 {
-    auto allocInfo = vk::CommandBufferAllocateInfo{};
-    allocInfo.setCommandPool( m_pCmdPool.get() );
-    allocInfo.setLevel( vk::CommandBufferLevel::ePrimary );
-    allocInfo.setCommandBufferCount( 1 );
-    m_pCmdBuffer = std::move( m_pDevice->allocateCommandBuffersUnique( allocInfo ).front() );
+    m_timings.totalSeconds = m_profiler.Now() - startSeconds;
+    auto gpuSeconds = m_timings.uploadSeconds + m_timings.dispatchSeconds + m_timings.downloadSeconds;
+    m_timings.hostSeconds = std::max( m_timings.totalSeconds - gpuSeconds, 0.0 );
+
+    if( m_profiling )
+        m_profiler.AddHostEvent( name, startSeconds, m_timings.totalSeconds );
+
+    return m_timings;
+}
+
+void Engine::DrainSlot( Slot& slot, const ChunkCopy& drain )
+{
+    if( slot.pendingCount == 0 )
+        return;
 
+    slot.binding.output.Invalidate( 0, slot.pendingCount * sizeof(float) );
+    drain( slot.binding.output, slot.pendingOffset, slot.pendingCount );
+    slot.pendingCount = 0;
+}
+
+void Engine::RecordCommandBuffer( Slot& slot, const std::function<void( vk::CommandBuffer )>& recordDispatch )
+{
+    auto cmdBuffer = slot.cmdBuffer.get();
+
+    // No eOneTimeSubmit, the same recording is submitted again by the next call of the same size
     auto beginInfo = vk::CommandBufferBeginInfo{};
-    beginInfo.setFlags( vk::CommandBufferUsageFlagBits::eOneTimeSubmit );
 
     /// Begin to Recording
     /// ==================
-    m_pCmdBuffer->begin( beginInfo );
+    cmdBuffer.reset();
+    cmdBuffer.begin( beginInfo );
     /// ------------------
 
+    if( m_profiling )
+    {
+        m_profiler.CmdReset( cmdBuffer, slot.queryRange );
+        m_profiler.CmdTimestamp( cmdBuffer, slot.queryRange, 0, vk::PipelineStageFlagBits::eTopOfPipe );
+        m_profiler.CmdBeginStatistics( cmdBuffer, slot.queryRange );
+    }
+
+    recordDispatch( cmdBuffer );
+
+    if( m_profiling )
     {
-        m_pCmdBuffer->bindPipeline( vk::PipelineBindPoint::eCompute, m_pPipeline.get() );
-        m_pCmdBuffer->bindDescriptorSets( vk::PipelineBindPoint::eCompute, m_pPipelineLayout.get(), 0, m_pSet.get(), nullptr );
-        m_pCmdBuffer->dispatch( 2, 1, 1 );
+        m_profiler.CmdEndStatistics( cmdBuffer, slot.queryRange );
+        m_profiler.CmdTimestamp( cmdBuffer, slot.queryRange, 1, vk::PipelineStageFlagBits::eBottomOfPipe );
     }
 
     /// End Recording
     /// =============
-    m_pCmdBuffer->end();
+    cmdBuffer.end();
     /// -------------
 }
 
+void Engine::RecordDispatch( vk::CommandBuffer cmdBuffer, vk::Pipeline pipeline, const KernelConfig& config, vk::DescriptorSet set, uint32_t elementCount, float scale ) const
+{
+    if( config.elementCount != 0 && config.elementCount != elementCount )
+        throw std::runtime_error("The pipeline has been specialized for another element count");
+
+    cmdBuffer.bindPipeline( vk::PipelineBindPoint::eCompute, pipeline );
+    cmdBuffer.bindDescriptorSets( vk::PipelineBindPoint::eCompute, m_pPipelineLayout.get(), 0, set, nullptr );
+
+    // ceil( n / ( local_size_x * unroll ) ), split when it is over the device limit of group count
+    uint32_t elementsPerGroup = config.GetElementsPerGroup();
+    uint32_t groupCount = static_cast<uint32_t>( ( static_cast<uint64_t>( elementCount ) + elementsPerGroup - 1 ) / elementsPerGroup );
+    for( uint32_t firstGroup = 0; firstGroup < groupCount; firstGroup += m_maxGroupCountX )
+    {
+        auto params = ComputeParams{};
+        params.count = elementCount;
+        params.offset = firstGroup * elementsPerGroup;
+        params.scale = scale;
+        cmdBuffer.pushConstants<ComputeParams>( m_pPipelineLayout.get(), vk::ShaderStageFlagBits::eCompute, 0, params );
+        cmdBuffer.dispatch( std::min( groupCount - firstGroup, m_maxGroupCountX ), 1, 1 );
+    }
+}
+
+void Engine::RecordDispatch( vk::CommandBuffer cmdBuffer, vk::Pipeline pipeline, const KernelConfig& config, const BufferRange& input, const BufferRange& output, uint32_t elementCount, float scale ) const
+{
+    if( config.elementCount != 0 && config.elementCount != elementCount )
+        throw std::runtime_error("The pipeline has been specialized for another element count");
+
+    cmdBuffer.bindPipeline( vk::PipelineBindPoint::eCompute, pipeline );
+
+    // As RecordDispatch() with a set, the addresses come with the count and the offset
+    uint32_t elementsPerGroup = config.GetElementsPerGroup();
+    uint32_t groupCount = static_cast<uint32_t>( ( static_cast<uint64_t>( elementCount ) + elementsPerGroup - 1 ) / elementsPerGroup );
+    for( uint32_t firstGroup = 0; firstGroup < groupCount; firstGroup += m_maxGroupCountX )
+    {
+        auto params = BindlessParams{};
+        params.input = input.address;
+        params.output = output.address;
+        params.count = elementCount;
+        params.offset = firstGroup * elementsPerGroup;
+        params.scale = scale;
+        cmdBuffer.pushConstants<BindlessParams>( m_pBindlessLayout.get(), vk::ShaderStageFlagBits::eCompute, 0, params );
+        cmdBuffer.dispatch( std::min( groupCount - firstGroup, m_maxGroupCountX ), 1, 1 );
+    }
+}
+
+void Engine::RecordIndirectDispatch( vk::CommandBuffer cmdBuffer, vk::Pipeline pipeline, vk::DescriptorSet set, const BufferRange& dispatchArgs, uint32_t maxCount, float scale ) const
+{
+    cmdBuffer.bindPipeline( vk::PipelineBindPoint::eCompute, pipeline );
+    cmdBuffer.bindDescriptorSets( vk::PipelineBindPoint::eCompute, m_pIndirectLayout.get(), 0, set, nullptr );
+
+    // The count comes from the arguments, the push constants only bound it
+    auto params = ComputeParams{};
+    params.count = maxCount;
+    params.offset = 0;
+    params.scale = scale;
+    cmdBuffer.pushConstants<ComputeParams>( m_pIndirectLayout.get(), vk::ShaderStageFlagBits::eCompute, 0, params );
+    cmdBuffer.dispatchIndirect( dispatchArgs.buffer, dispatchArgs.offset );
+}
+
+void Engine::RecordDispatchArgs( vk::CommandBuffer cmdBuffer, vk::Pipeline pipeline, vk::DescriptorSet set, const KernelConfig& config, uint32_t maxCount ) const
+{
+    cmdBuffer.bindPipeline( vk::PipelineBindPoint::eCompute, pipeline );
+    cmdBuffer.bindDescriptorSets( vk::PipelineBindPoint::eCompute, m_pIndirectLayout.get(), 0, set, nullptr );
+    cmdBuffer.pushConstants<DispatchArgsParams>( m_pIndirectLayout.get(), vk::ShaderStageFlagBits::eCompute, 0, DispatchArgsParams{ maxCount, config.GetElementsPerGroup() } );
+    cmdBuffer.dispatch( 1, 1, 1 );
+}
+
+bool Engine::UseBindless( const BufferRange& input, const BufferRange& output ) const
+{
+    return m_bindless && input.address != 0 && output.address != 0;
+}
+
 void Engine::CreatePipelineLayout()
 {
     /// Descriptor Set Layout
@@ -227,18 +2273,92 @@ void Engine::CreatePipelineLayout()
         m_pSetLayout = m_pDevice->createDescriptorSetLayoutUnique( setLayoutInfo );
     }
 
+    /// Push Constant (element count and offset, so one pipeline works for any size)
+    auto pushConstantRange = vk::PushConstantRange{};
+    pushConstantRange.setStageFlags( vk::ShaderStageFlagBits::eCompute );
+    pushConstantRange.setOffset( 0 );
+    pushConstantRange.setSize( sizeof(ComputeParams) );
+
     /// Pipeline Layout
     auto layoutInfo = vk::PipelineLayoutCreateInfo{};
     layoutInfo.setSetLayouts( m_pSetLayout.get() );
+    layoutInfo.setPushConstantRanges( pushConstantRange );
     m_pPipelineLayout = m_pDevice->createPipelineLayoutUnique( layoutInfo );
+
+    /// Bindless: no set, the device addresses are push constants too
+    if( m_bufferDeviceAddress )
+    {
+        auto bindlessRange = vk::PushConstantRange{};
+        bindlessRange.setStageFlags( vk::ShaderStageFlagBits::eCompute );
+        bindlessRange.setOffset( 0 );
+        bindlessRange.setSize( sizeof(BindlessParams) );
+
+        auto bindlessLayoutInfo = vk::PipelineLayoutCreateInfo{};
+        bindlessLayoutInfo.setPushConstantRanges( bindlessRange );
+        m_pBindlessLayout = m_pDevice->createPipelineLayoutUnique( bindlessLayoutInfo );
+    }
+
+    /// Kernel library, storage buffers only and its own push constants:
+    ///   - library.comp: input, output and block totals
+    ///   - sort.comp: keys in and out, histogram, values in and out
+    /// The indirect stages of a graph take the same kind of layout (input, output and dispatch arguments),
+    /// its push constants cover ComputeParams and the ones of dispatch.comp.
+    auto createLibraryLayout = [this]( uint32_t bindingCount, vk::UniqueDescriptorSetLayout& pSetLayout, vk::UniquePipelineLayout& pLayout ){
+        std::vector<vk::DescriptorSetLayoutBinding> setLayoutBinding( bindingCount );
+        for( uint32_t i = 0; i < bindingCount; ++i )
+        {
+            setLayoutBinding[i].setBinding( i );
+            setLayoutBinding[i].setDescriptorCount( 1 );
+            setLayoutBinding[i].setDescriptorType( vk::DescriptorType::eStorageBuffer );
+            setLayoutBinding[i].setStageFlags( vk::ShaderStageFlagBits::eCompute );
+        }
+
+        auto setLayoutInfo = vk::DescriptorSetLayoutCreateInfo{};
+        setLayoutInfo.setBindings( setLayoutBinding );
+        pSetLayout = m_pDevice->createDescriptorSetLayoutUnique( setLayoutInfo );
+
+        auto libraryRange = vk::PushConstantRange{};
+        libraryRange.setStageFlags( vk::ShaderStageFlagBits::eCompute );
+        libraryRange.setOffset( 0 );
+        libraryRange.setSize( sizeof(LibraryParams) );
+
+        auto libraryLayoutInfo = vk::PipelineLayoutCreateInfo{};
+        libraryLayoutInfo.setSetLayouts( pSetLayout.get() );
+        libraryLayoutInfo.setPushConstantRanges( libraryRange );
+        pLayout = m_pDevice->createPipelineLayoutUnique( libraryLayoutInfo );
+    };
+    createLibraryLayout( 3, m_pLibrarySetLayout, m_pLibraryLayout );
+    createLibraryLayout( 5, m_pSortSetLayout, m_pSortLayout );
+    createLibraryLayout( 3, m_pIndirectSetLayout, m_pIndirectLayout );
+}
+
+vk::UniquePipeline Engine::CreatePipeline( const KernelConfig& config )
+{
+    return this->CreatePipeline( KernelSource( false ), m_pPipelineLayout.get(), config );
 }
 
-void Engine::CreatePipeline()
+vk::UniquePipeline Engine::CreateBindlessPipeline( const KernelConfig& config )
+{
+    return this->CreatePipeline( KernelSource( true ), m_pBindlessLayout.get(), config );
+}
+
+vk::UniquePipeline Engine::CreatePipeline( const ShaderSource& source, vk::PipelineLayout layout, const KernelConfig& config )
 {
     /// Creating Module
     /// ===============
-    auto shaderPath = std::string(SHADER_PATH) + std::string("/shader.comp.spv");
-    auto pShaderModule = this->CreateShaderModule( shaderPath );
+    auto pShaderModule = this->CreateShaderModule( m_shaderCompiler.Compile( source.path, source.defines ) );
+
+    /// Specialization Constants
+    /// ========================
+    std::array<vk::SpecializationMapEntry, 3> mapEntries {
+        vk::SpecializationMapEntry{ 0, offsetof( KernelConfig, localSizeX ), sizeof(uint32_t) },
+        vk::SpecializationMapEntry{ 1, offsetof( KernelConfig, unroll ), sizeof(uint32_t) },
+        vk::SpecializationMapEntry{ 2, offsetof( KernelConfig, elementCount ), sizeof(uint32_t) },
+    };
+    auto specializationInfo = vk::SpecializationInfo{};
+    specializationInfo.setMapEntries( mapEntries );
+    specializationInfo.setDataSize( sizeof(KernelConfig) );
+    specializationInfo.setPData( &config );
 
     /// Filling Shader Stage Info
     /// ==========================
@@ -246,179 +2366,459 @@ void Engine::CreatePipeline()
     shaderStageInfo.setStage( vk::ShaderStageFlagBits::eCompute );
     shaderStageInfo.setPName("main");
     shaderStageInfo.setModule( pShaderModule.get() );
+    shaderStageInfo.setPSpecializationInfo( &specializationInfo );
 
     /// Creating Pipeline
     /// =================
     auto pipelineInfo = vk::ComputePipelineCreateInfo{};
     pipelineInfo.setStage( shaderStageInfo );
     pipelineInfo.setBasePipelineIndex( -1 );
-    pipelineInfo.setLayout( m_pPipelineLayout.get() );
+    pipelineInfo.setLayout( layout );
 
-    auto checker =  m_pDevice->createComputePipelinesUnique( VK_NULL_HANDLE, pipelineInfo );
+    auto checker =  m_pDevice->createComputePipelinesUnique( m_pipelineCache.Get(), pipelineInfo );
     assert( checker.result == vk::Result::eSuccess );
-    m_pPipeline = std::move( checker.value[0] );    // Because we just create single pipeline
+    return std::move( checker.value[0] );    // Because we just create single pipeline
+}
+
+KernelConfig Engine::DefaultKernelConfig() const
+{
+    // 256 is a good start almost everywhere, as long as the device allows it
+    auto config = KernelConfig{};
+    config.localSizeX = std::min( { 256u, m_maxGroupSizeX, m_maxGroupInvocations } );
+    if( config.localSizeX >= m_subgroupSize )
+        config.localSizeX -= config.localSizeX % m_subgroupSize;
+    return config;
+}
+
+bool Engine::IsKernelConfigSupported( const KernelConfig& config ) const
+{
+    return config.localSizeX != 0 &&
+           config.unroll != 0 &&
+           config.localSizeX <= m_maxGroupSizeX &&
+           config.localSizeX <= m_maxGroupInvocations;
+}
+
+std::vector<KernelConfig> Engine::AutotuneCandidates() const
+{
+    std::vector<KernelConfig> candidates;
+    for( uint32_t localSizeX = 64; localSizeX <= 1024; localSizeX *= 2 )
+    {
+        if( localSizeX % m_subgroupSize != 0 )  // Some lanes of every workgroup would be idle
+            continue;
+
+        for( uint32_t unroll = 1; unroll <= 4; unroll *= 2 )
+        {
+            auto config = KernelConfig{};
+            config.localSizeX = localSizeX;
+            config.unroll = unroll;
+            if( this->IsKernelConfigSupported( config ) )
+                candidates.push_back( config );
+        }
+    }
+    return candidates;
+}
+
+double Engine::TimeDispatch( vk::Pipeline pipeline, const KernelConfig& config, vk::DescriptorSet set, uint32_t elementCount )
+{
+    auto cmdBuffer = this->BeginImmediate();
+    m_profiler.CmdReset( cmdBuffer, kTransferQueryRange );
+    m_profiler.CmdTimestamp( cmdBuffer, kTransferQueryRange, 0, vk::PipelineStageFlagBits::eTopOfPipe );
+    this->RecordDispatch( cmdBuffer, pipeline, config, set, elementCount );
+    m_profiler.CmdTimestamp( cmdBuffer, kTransferQueryRange, 1, vk::PipelineStageFlagBits::eBottomOfPipe );
+    this->SubmitImmediate();
+
+    return m_profiler.GetSeconds( kTransferQueryRange, 0, 1 );
+}
+
+vk::Pipeline Engine::GetLibraryPipeline( LibraryKernel kernel, ReduceOp op, ElementType type, ScanMode mode )
+{
+    auto source = ShaderSource{ std::string(SHADER_PATH) + std::string("/library.comp"),
+                                GetLibraryDefines( kernel, op, type, mode, m_subgroupArithmetic, kLibraryItems ) };
+    return this->GetCachedPipeline( source, m_pLibraryLayout.get(), this->LibraryKernelConfig() );
+}
+
+vk::Pipeline Engine::GetCachedPipeline( const ShaderSource& source, vk::PipelineLayout layout, const KernelConfig& config )
+{
+    auto key = source.path;
+    for( const auto& [name, value] : source.defines )
+        key += ";" + name + "=" + value;
+    key += ";" + std::to_string( config.localSizeX ) + "," + std::to_string( config.unroll ) + "," + std::to_string( config.elementCount );
+
+    auto& pPipeline = m_libraryPipelines[key];
+    if( !pPipeline )
+        pPipeline = this->CreatePipeline( source, layout, config );
+    return pPipeline.get();
+}
+
+KernelConfig Engine::LibraryKernelConfig() const
+{
+    auto config = KernelConfig{};   // Only the local size is a specialization constant of the library kernels
+    config.localSizeX = m_libraryLocalSize;
+    return config;
+}
+
+vk::UniqueDescriptorSet Engine::AllocateLibrarySet( vk::DescriptorSetLayout layout, std::initializer_list<BufferRange> ranges )
+{
+    auto setAllocateInfo = vk::DescriptorSetAllocateInfo{};
+    setAllocateInfo.setDescriptorPool( m_pDescPool.get() );
+    setAllocateInfo.setSetLayouts( layout );
+    setAllocateInfo.setDescriptorSetCount( 1 );
+    auto pSet = std::move( m_pDevice->allocateDescriptorSetsUnique( setAllocateInfo )[0] );
+
+    /// One storage buffer for each binding, in order
+    std::vector<vk::DescriptorBufferInfo> descriptorBufferInfos;
+    for( const auto& range : ranges )
+        descriptorBufferInfos.emplace_back( range.buffer, range.offset, range.size );
+
+    auto writeDescriptorSet = vk::WriteDescriptorSet{};
+    writeDescriptorSet.setBufferInfo( descriptorBufferInfos );
+    writeDescriptorSet.setDescriptorType( vk::DescriptorType::eStorageBuffer );
+    writeDescriptorSet.setDescriptorCount( static_cast<uint32_t>( descriptorBufferInfos.size() ) );
+    writeDescriptorSet.setDstSet( pSet.get() );
+    writeDescriptorSet.setDstBinding( 0 );
+    m_pDevice->updateDescriptorSets( writeDescriptorSet, nullptr );
+
+    return pSet;
+}
+
+void Engine::RecordLibraryDispatch( vk::CommandBuffer cmdBuffer, vk::PipelineLayout layout, vk::Pipeline pipeline, vk::DescriptorSet set, LibraryParams params, uint32_t groupCount ) const
+{
+    cmdBuffer.bindPipeline( vk::PipelineBindPoint::eCompute, pipeline );
+    cmdBuffer.bindDescriptorSets( vk::PipelineBindPoint::eCompute, layout, 0, set, nullptr );
+
+    for( uint32_t firstGroup = 0; firstGroup < groupCount; firstGroup += m_maxGroupCountX )
+    {
+        params.firstGroup = firstGroup;
+        cmdBuffer.pushConstants<LibraryParams>( layout, vk::ShaderStageFlagBits::eCompute, 0, params );
+        cmdBuffer.dispatch( std::min( groupCount - firstGroup, m_maxGroupCountX ), 1, 1 );
+    }
+}
+
+uint32_t Engine::GetLibraryBlockCount( uint32_t elementCount, uint32_t items ) const
+{
+    uint64_t blockSize = m_libraryLocalSize * items;
+    return static_cast<uint32_t>( ( elementCount + blockSize - 1 ) / blockSize );
+}
+
+Engine::ScanPlan Engine::PlanScan( uint32_t elementCount ) const
+{
+    /// The block totals of a level are the elements of the next one, down to a level of a single block
+    auto plan = ScanPlan{};
+    plan.counts.push_back( elementCount );
+    while( plan.counts.back() > m_libraryLocalSize * kLibraryItems )
+        plan.counts.push_back( this->GetLibraryBlockCount( plan.counts.back(), kLibraryItems ) );
+
+    /// Every level below the first one is a part of a single scratch range
+    plan.offsets.resize( plan.counts.size() );
+    for( size_t i = 1; i < plan.counts.size(); ++i )
+    {
+        plan.offsets[i] = plan.scratchSize;
+        size_t size = plan.counts[i] * sizeof(uint32_t);
+        plan.scratchSize += ( size + m_storageAlignment - 1 ) / m_storageAlignment * m_storageAlignment;
+    }
+    return plan;
+}
+
+std::vector<vk::UniqueDescriptorSet> Engine::AllocateScanSets( const ScanPlan& plan, const BufferRange& input, const BufferRange& output, const BufferRange& scratch )
+{
+    auto level = [&]( size_t i ){
+        auto range = scratch;
+        range.offset += plan.offsets[i];
+        range.size = plan.counts[i] * sizeof(uint32_t);
+        return range;
+    };
+
+    /// One set for each level: its input, its output (the level itself below the first one) and the next level
+    std::vector<vk::UniqueDescriptorSet> sets;
+    for( size_t i = 0; i < plan.counts.size(); ++i )
+    {
+        auto levelInput = i == 0 ? input : level( i );
+        auto levelOutput = i == 0 ? output : level( i );
+        auto totals = i + 1 < plan.counts.size() ? level( i + 1 ) : levelOutput;
+        sets.push_back( this->AllocateLibrarySet( m_pLibrarySetLayout.get(), { levelInput, levelOutput, totals } ) );
+    }
+    return sets;
+}
+
+void Engine::RecordScan( vk::CommandBuffer cmdBuffer, const ScanPlan& plan, const std::vector<vk::UniqueDescriptorSet>& sets, ReduceOp op, ElementType type, ScanMode mode )
+{
+    const auto& counts = plan.counts;
+    auto reducePipeline = this->GetLibraryPipeline( LibraryKernel::eBlockReduce, op, type );
+    auto scanPipeline = this->GetLibraryPipeline( LibraryKernel::eBlockScan, op, type, mode );
+    auto totalsPipeline = counts.size() > 1 ? this->GetLibraryPipeline( LibraryKernel::eBlockScan, op, type, ScanMode::eExclusive ) : scanPipeline;
+
+    // Down: the total of every block, level after level
+    for( size_t i = 0; i + 1 < counts.size(); ++i )
+    {
+        this->RecordLibraryDispatch( cmdBuffer, m_pLibraryLayout.get(), reducePipeline, sets[i].get(), LibraryParams{ counts[i] }, counts[i + 1] );
+        ShaderWriteBarrier( cmdBuffer, vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite );
+    }
+
+    // Up: the last level is a single block, every other level is scanned from the scanned totals of the next one
+    for( size_t i = counts.size(); i-- > 0; )
+    {
+        auto pipeline = i == 0 ? scanPipeline : totalsPipeline;
+        auto params = LibraryParams{ counts[i], 0, i + 1 < counts.size() ? 1u : 0u };
+        this->RecordLibraryDispatch( cmdBuffer, m_pLibraryLayout.get(), pipeline, sets[i].get(), params, this->GetLibraryBlockCount( counts[i], kLibraryItems ) );
+        if( i != 0 )
+            ShaderWriteBarrier( cmdBuffer, vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite );
+    }
 }
 
 void Engine::CreateDescriptorPool()
 {
+    // Compute(), the imported buffers, and two for each slot of the ring (2 storage buffers each),
+    // plus the sets of a kernel library call (3 storage buffers for each scan level, 5 for the two of a sort)
     std::vector<vk::DescriptorPoolSize> poolSizes {
-        { vk::DescriptorType::eStorageBuffer, 10 }
+        { vk::DescriptorType::eStorageBuffer, 64 }
     };
 
     auto descPoolInfo = vk::DescriptorPoolCreateInfo{};
     descPoolInfo.setPoolSizes( poolSizes );
-    descPoolInfo.setMaxSets( 10 );
+    descPoolInfo.setMaxSets( 24 );
     descPoolInfo.setFlags( vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet );
 
     m_pDescPool = m_pDevice->createDescriptorPoolUnique( descPoolInfo );
 }
 
-void Engine::AllocateDescriptorSet()
+vk::UniqueDescriptorSet Engine::AllocateDescriptorSet()
 {
     auto setAllocateInfo = vk::DescriptorSetAllocateInfo{};
     setAllocateInfo.setDescriptorPool( m_pDescPool.get() );
     setAllocateInfo.setSetLayouts( m_pSetLayout.get() );
     setAllocateInfo.setDescriptorSetCount( 1 );
 
-    m_pSet = std::move( m_pDevice->allocateDescriptorSetsUnique( setAllocateInfo )[0] );
-
-    auto allocInfo = vma::AllocationCreateInfo{};
-    allocInfo.setUsage( vma::MemoryUsage::eCpuToGpu );
+    return std::move( m_pDevice->allocateDescriptorSetsUnique( setAllocateInfo )[0] );
 }
 
-void Engine::AllocateBuffers( size_t inputSize, size_t outputSize )
+void Engine::AllocateBuffers( IoBinding& binding, size_t inputSize, size_t outputSize )
 {
     /// Allocating input buffer and output buffer
-    m_inputBuffer = Buffer( m_allocator, inputSize, vk::BufferUsageFlagBits::eStorageBuffer, vma::MemoryUsage::eCpuToGpu );
-    m_outputBuffer = Buffer( m_allocator, outputSize, vk::BufferUsageFlagBits::eStorageBuffer, vma::MemoryUsage::eCpuToGpu );
-    // Regist to deletion function
-    m_inputBuffer.DelQueueRegistered( m_delQueue );
-    m_outputBuffer.DelQueueRegistered( m_delQueue );
+    if( binding.deviceLocal )
+    {
+        binding.input = Buffer( m_allocator, inputSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, BufferIntent::eDeviceLocal, this->SharedQueueFamilies() );
+        binding.output = Buffer( m_allocator, outputSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc, BufferIntent::eDeviceLocal, this->SharedQueueFamilies() );
+    }
+    else
+    {
+        binding.input = Buffer( m_allocator, inputSize, vk::BufferUsageFlagBits::eStorageBuffer, BufferIntent::eUpload );
+        binding.output = Buffer( m_allocator, outputSize, vk::BufferUsageFlagBits::eStorageBuffer, BufferIntent::eReadback );
+    }
+    binding.inputRange = binding.input.GetRange();
+    binding.outputRange = binding.output.GetRange();
+
+    this->UpdateDescriptorSet( binding );
+}
 
+void Engine::UpdateDescriptorSet( const IoBinding& binding )
+{
     /// Description (not descriptor) about the buffers
     std::array<vk::DescriptorBufferInfo, 2> descriptorBufferInfos{};
-    descriptorBufferInfos[0].setBuffer( m_inputBuffer.GetBuffer());
-    descriptorBufferInfos[0].setOffset(0);
-    descriptorBufferInfos[0].setRange( inputSize );
-    descriptorBufferInfos[1].setBuffer( m_outputBuffer.GetBuffer() );
-    descriptorBufferInfos[1].setOffset(0);
-    descriptorBufferInfos[1].setRange( outputSize );
+    descriptorBufferInfos[0].setBuffer( binding.inputRange.buffer );
+    descriptorBufferInfos[0].setOffset( binding.inputRange.offset );
+    descriptorBufferInfos[0].setRange( binding.inputRange.size );
+    descriptorBufferInfos[1].setBuffer( binding.outputRange.buffer );
+    descriptorBufferInfos[1].setOffset( binding.outputRange.offset );
+    descriptorBufferInfos[1].setRange( binding.outputRange.size );
 
     /// What buffers should the descriptors points to
     auto writeDescriptorSet = vk::WriteDescriptorSet{};
     writeDescriptorSet.setBufferInfo( descriptorBufferInfos );
     writeDescriptorSet.setDescriptorType( vk::DescriptorType::eStorageBuffer ); // So, the descriptor also has some type :)
     writeDescriptorSet.setDescriptorCount( 2 );
-    writeDescriptorSet.setDstSet( m_pSet.get() );
+    writeDescriptorSet.setDstSet( binding.set.get() );
     writeDescriptorSet.setDstBinding( 0 );
 
     /// Updating that the descriptor now has pointed to the buffer
     m_pDevice->updateDescriptorSets( writeDescriptorSet, nullptr );
 }
 
-vk::PhysicalDevice Engine::PickPhysicalDevice(const std::vector<vk::QueueFlagBits>& flags) const
+void Engine::ReserveBuffers( IoBinding& binding, size_t elementCount, size_t maxCapacity )
+{
+    if( elementCount <= binding.capacity )
+        return;
+
+    // Growing geometrically, so a series of slightly bigger jobs does not reallocate on every call
+    // (up to maxCapacity, the size of a tile). Rounded up to the elements of a workgroup, so the last
+    // workgroup never ends outside the buffer.
+    size_t capacity = std::min( std::max( elementCount, binding.capacity * 2 ), std::max( elementCount, maxCapacity ) );
+    size_t elementsPerGroup = m_kernelConfig.GetElementsPerGroup();
+    capacity = ( capacity + elementsPerGroup - 1 ) / elementsPerGroup * elementsPerGroup;
+
+    // The old buffers are destroyed once the submissions that may use them have completed.
+    // The descriptor set is re-written right away, the caller has waited every submission that uses this binding.
+    this->DestroyBuffers( binding );
+
+    if( !binding.set )
+        binding.set = this->AllocateDescriptorSet();
+
+    this->AllocateBuffers( binding, capacity * sizeof(uint32_t), capacity * sizeof(float) );
+    binding.capacity = capacity;
+    ++binding.generation;   // Every recorded command buffer refers the old buffers
+}
+
+bool Engine::CanImportHostMemory( const void* hostPointer, size_t size ) const
+{
+    return m_hostImportAlignment != 0 &&
+           size >= kHostImportThreshold &&
+           reinterpret_cast<uintptr_t>( hostPointer ) % m_hostImportAlignment == 0;
+}
+
+bool Engine::ComputeImported( std::span<const uint32_t> input, std::span<float> output )
+{
+    auto elementCount = static_cast<uint32_t>( input.size() );
+    auto alignUp = [alignment=m_hostImportAlignment]( size_t size ){
+        return ( size + alignment - 1 ) / alignment * alignment;
+    };
+
+    // Rounding the size up stays inside the last (page aligned) block of the caller's allocation,
+    // and the shader never touches the element past the count
+    auto& binding = m_importBinding;
+    binding.input.Destroy();
+    binding.output.Destroy();
+    if( !binding.set )
+        binding.set = this->AllocateDescriptorSet();
+
+    // The GPU only reads the input, the const_cast is just for the import API
+    try
+    {
+        binding.input = Buffer::ImportHostMemory( m_pDevice.get(), m_physicalDevice, const_cast<uint32_t*>( input.data() ),
+                                                  alignUp( input.size_bytes() ), vk::BufferUsageFlagBits::eStorageBuffer );
+        binding.output = Buffer::ImportHostMemory( m_pDevice.get(), m_physicalDevice, output.data(),
+                                                   alignUp( elementCount * sizeof(float) ), vk::BufferUsageFlagBits::eStorageBuffer );
+    }
+    catch( const std::exception& )
+    {
+        binding.input.Destroy();    // Nothing has been submitted with it
+        return false;
+    }
+    binding.inputRange = binding.input.GetRange();
+    binding.outputRange = binding.output.GetRange();
+    this->UpdateDescriptorSet( binding );
+    ++binding.generation;
+
+    auto& slot = this->AcquireSlot();
+    this->Submit( slot, binding, elementCount, m_pPipeline.get() );
+
+    this->WaitTimeline( *m_pComputeQueue, slot.submittedValue );
+    this->CollectTimings( slot );
+
+    // Right now, not deferred: the caller may free its memory as soon as Compute() returns
+    binding.input.Destroy();
+    binding.output.Destroy();
+    return true;
+}
+
+void Engine::DestroyBuffers( IoBinding& binding )
+{
+    binding.input.DelQueueRegistered( m_delQueue, m_pComputeQueue->submittedValue );
+    binding.output.DelQueueRegistered( m_delQueue, m_pComputeQueue->submittedValue );
+    binding.input = Buffer{};
+    binding.output = Buffer{};
+    binding.capacity = 0;
+}
+
+vk::PhysicalDevice Engine::PickPhysicalDevice( uint32_t deviceIndex ) const
 {
     /// Enumerating all the physical devices that available
     auto physicalDevices = m_pInstance->enumeratePhysicalDevices();
 
-    /// Finding the best suitable physical device
-    vk::PhysicalDevice choose;
+    /// The deviceIndex-th suitable one, as counted by CountGpus()
     for( auto& physicalDevice : physicalDevices )
     {
-        bool found = true;
-
-        // Finding phyiscal device that has "flags" that we want
-        auto indices = FindQueueFamilyIndices( physicalDevice, flags );
+        if( !IsPhysicalDeviceSuitable( physicalDevice ) )
+            continue;
+        if( deviceIndex == 0 )
+            return physicalDevice;
+        --deviceIndex;
+    }
+    return vk::PhysicalDevice{};
+}
 
-        // If the indices has empty value (has no value)
-        for( const auto& i : indices )
-        {
-            if( !i.has_value() )
-                found = false;
-        }
+bool Engine::IsPhysicalDeviceSuitable( const vk::PhysicalDevice& physicalDevice )
+{
+    // Finding phyiscal device that has a compute queue family
+    if( !FindQueueFamilies( physicalDevice ) )
+        return false;
 
-        // If the indices has value
-        if( found )
-        {
-            choose = physicalDevice;
-            break;
-        }
-    }
-    return choose;
+    // Every synchronization of the engine is a timeline semaphore (core since Vulkan 1.2)
+    auto features = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+    return features.get<vk::PhysicalDeviceVulkan12Features>().timelineSemaphore;
 }
 
-std::vector<std::optional<size_t>> Engine::FindQueueFamilyIndices( const vk::PhysicalDevice& physicalDevice, const std::vector<vk::QueueFlagBits>& flags ) const
+std::optional<Engine::QueueFamilies> Engine::FindQueueFamilies( const vk::PhysicalDevice& physicalDevice )
 {
     auto queueFamilyProperties = physicalDevice.getQueueFamilyProperties();
-    auto& queueFamilies = flags;
 
-    // Index 0: Compute; Index 1: Graphics (If any)
-    std::vector<std::optional<size_t>> queueFamilyIndices;
-    queueFamilyIndices.reserve( queueFamilies.size() );
+    std::optional<uint32_t> compute;
+    std::optional<uint32_t> transfer;
+    for( uint32_t i = 0; i < queueFamilyProperties.size(); ++i )
+    {
+        const auto& prop = queueFamilyProperties[i];
+        if( prop.queueCount == 0 )
+            continue;
 
-    std::vector<uint32_t> qfis;
+        bool hasCompute = static_cast<bool>( prop.queueFlags & vk::QueueFlagBits::eCompute );
+        bool hasGraphics = static_cast<bool>( prop.queueFlags & vk::QueueFlagBits::eGraphics );
 
-    size_t i = 0;
-    for( const auto& prop : queueFamilyProperties )
-    {
-        size_t j = 0;
-        for( const auto& queueFam : queueFamilies )
-        {
-            if( prop.queueCount > 0 &&
-                (prop.queueFlags & queueFam))
-            {
-                queueFamilyIndices[j] = i;
-                qfis.push_back(static_cast<uint32_t>(i));
-            }
-            ++j;
-        }
-        ++i;
+        // A compute family without graphics is not shared with rendering (async compute)
+        if( hasCompute && ( !compute || ( !hasGraphics && ( queueFamilyProperties[*compute].queueFlags & vk::QueueFlagBits::eGraphics ) ) ) )
+            compute = i;
+
+        // Transfer-only: the copy engines, which run beside the compute units
+        if( !transfer && !hasCompute && !hasGraphics && ( prop.queueFlags & vk::QueueFlagBits::eTransfer ) )
+            transfer = i;
     }
 
-    return queueFamilyIndices;
+    if( !compute )
+        return std::nullopt;
+    return QueueFamilies{ *compute, queueFamilyProperties[*compute].queueCount, transfer };
 }
 
 vk::UniqueDevice Engine::CreateDevice() const
 {
-    auto queueFamily = FindQueueFamilyIndices( m_physicalDevice, m_queueFlags );
-
-    // "1" because we want queueFamily of 0 (why? because queuefaily of 0 have more queue count)
-    // In the future, maybe it coulbe be source of bug.
-    uint32_t queueIndex = static_cast<uint32_t>( queueFamily[1].value() );
-
-    float queuePriority = 1.0f;
-    vk::DeviceQueueCreateInfo queueInfo {
-        vk::DeviceQueueCreateFlags(),
-        queueIndex,     // NOTE: This also could be source of bug, in the future.
-        1,              // queue count
-        &queuePriority  // queue priority
-    };
+    // Checked by PickPhysicalDevice()
+    auto families = *FindQueueFamilies( m_physicalDevice );
+
+    // Two compute queues when the family has them (the second one runs SubmitAsync()), and one
+    // transfer queue if the device has a transfer-only family
+    std::vector<float> computePriorities( std::min( families.computeCount, 2u ), 1.0f );
+    float transferPriority = 1.0f;
+    std::vector<vk::DeviceQueueCreateInfo> queueInfos( 1 );
+    queueInfos[0].setQueueFamilyIndex( families.compute );
+    queueInfos[0].setQueuePriorities( computePriorities );
+    if( families.transfer )
+    {
+        auto transferInfo = vk::DeviceQueueCreateInfo{};
+        transferInfo.setQueueFamilyIndex( *families.transfer );
+        transferInfo.setQueueCount( 1 );
+        transferInfo.setPQueuePriorities( &transferPriority );
+        queueInfos.push_back( transferInfo );
+    }
 
-    // auto deviceExtensions = m_physicalDevice.enumerateDeviceExtensionProperties();
-    // std::vector<const char*> enabledExtension = { VK_NV_COMPUTE_SHADER_DERIVATIVES_EXTENSION_NAME };
-    // std::vector<const char*> extensions;
-    // extensions.reserve( enabledExtension.size() );
-    // for ( const auto& extension : enabledExtension )
-    // {
-    //     auto found = std::find_if( deviceExtensions.begin(), deviceExtensions.end(),
-    //                     [&extension]( const vk::ExtensionProperties& ext ){ return strcmp( ext.extensionName, extension ) == 0; }
-    //     );
-    //     assert( found != deviceExtensions.end() );
-    //     extensions.push_back( extension );
-    // }
-    std::vector<const char*> extensions = {}; // For now, i do not use any extension
-    
+    auto extensions = this->DeviceExtensions();
 
     auto deviceFeatures = m_physicalDevice.getFeatures();
-    auto validateLayers = this->InstanceValidations();
     vk::DeviceCreateInfo deviceInfo {
         vk::DeviceCreateFlags(),
-        queueInfo,
-        validateLayers,   // device validation layers
+        queueInfos,
+        m_validationLayers,   // device validation layers
         extensions,                     // device extensions
         &deviceFeatures                 // device features
     };
 
+    // Checked by PickPhysicalDevice(), and by InitializeVulkanBase() for the device addresses and the narrow storage
+    auto vulkan11Features = vk::PhysicalDeviceVulkan11Features{};
+    vulkan11Features.setStorageBuffer16BitAccess( m_storage16Bit );
+    auto vulkan12Features = vk::PhysicalDeviceVulkan12Features{};
+    vulkan12Features.setTimelineSemaphore( true );
+    vulkan12Features.setBufferDeviceAddress( m_bufferDeviceAddress );
+    vulkan12Features.setStorageBuffer8BitAccess( m_storage8Bit );
+    vulkan12Features.setShaderFloat16( m_shaderFloat16 );
+    vulkan12Features.setShaderInt8( m_shaderInt8 );
+    vulkan12Features.setPNext( &vulkan11Features );
+    deviceInfo.setPNext( &vulkan12Features );
+
     return m_physicalDevice.createDeviceUnique( deviceInfo );
 }
 
@@ -438,48 +2838,70 @@ std::vector<const char*> Engine::InstanceExtensions() const
     return extensions;
 }
 
+std::vector<const char*> Engine::DeviceExtensions() const
+{
+    /// Optional extensions, only enabled when the physical device has them
+    std::vector<const char*> optionalExtensions = {
+        VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME,     // Zero-copy import of host memory
+        VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,            // Tiling of the jobs larger than the memory left
+    };
+
+    std::vector<const char*> extensions;
+    for( const auto& extension : optionalExtensions )
+    {
+        if( this->IsDeviceExtensionSupported( extension ) )
+            extensions.push_back( extension );
+    }
+
+    return extensions;
+}
+
+bool Engine::IsDeviceExtensionSupported( const char* extensionName ) const
+{
+    auto deviceExtensions = m_physicalDevice.enumerateDeviceExtensionProperties();
+    auto found = std::find_if( deviceExtensions.begin(), deviceExtensions.end(),
+                    [&extensionName]( const vk::ExtensionProperties& ext ){ return strcmp( ext.extensionName, extensionName ) == 0; }
+    );
+    return found != deviceExtensions.end();
+}
+
 std::vector<const char*> Engine::InstanceValidations() const
 {
     return { "VK_LAYER_KHRONOS_validation" };
 }
 
-std::vector<char> Engine::readFile( const std::string& fileName, bool isSPIRV ) const
+vk::CommandBuffer Engine::BeginImmediate()
 {
-    std::ifstream file(fileName, std::ios::ate | std::ios::binary);
-
-    if (!file.is_open()) {
-        throw std::runtime_error(std::string("Failed to open: ") + fileName);
-    }
+    auto cmdBuffer = m_pImmediateCmdBuffer.get();
+    this->WaitTimeline( *m_pComputeQueue, m_immediateValue );  // Its last submission may still run (uploads are not waited)
 
-    // if( !isSPIRV )
-    // {
-    //     auto compiler = shaderc::Compiler{};
-    //     auto options = shaderc::CompileOptions{};
-    //     shaderc::SpvCompilationResult moduleResult = compiler.CompileGlslToSpv()
-    // }
+    auto beginInfo = vk::CommandBufferBeginInfo{};
+    beginInfo.setFlags( vk::CommandBufferUsageFlagBits::eOneTimeSubmit );
 
-    size_t fileSize = (size_t)file.tellg();
-    std::vector<char> buffer(fileSize);
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
+    cmdBuffer.reset();
+    cmdBuffer.begin( beginInfo );
+    return cmdBuffer;
+}
 
-    file.close();
+void Engine::SubmitImmediate()
+{
+    auto cmdBuffer = m_pImmediateCmdBuffer.get();
+    cmdBuffer.end();
 
-    return buffer;
+    m_immediateValue = this->SubmitTimeline( *m_pComputeQueue, cmdBuffer, m_pTransferQueue );
+    this->WaitTimeline( *m_pComputeQueue, m_immediateValue );
 }
 
 /**
  * @brief Creating shader module
  * 
- * @param fileName 
+ * @param spirv from ShaderCompiler
  * @return vk::UniqueShaderModule 
  */
-vk::UniqueShaderModule Engine::CreateShaderModule( const std::string& fileName ) const
+vk::UniqueShaderModule Engine::CreateShaderModule( const std::vector<uint32_t>& spirv ) const
 {
-    auto code = this->readFile( fileName );
     auto shaderModuleInfo = vk::ShaderModuleCreateInfo{};
-    shaderModuleInfo.setCodeSize( code.size() );
-    shaderModuleInfo.setPCode( reinterpret_cast<uint32_t*>(code.data()) );
+    shaderModuleInfo.setCode( spirv );
 
     return m_pDevice->createShaderModuleUnique( shaderModuleInfo );
 }
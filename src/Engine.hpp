@@ -2,9 +2,32 @@
 
 #include "DeletionQueue.hpp"
 #include "Buffer.hpp"
+#include "LinearArena.hpp"
+#include "BufferPool.hpp"
+#include "PipelineCache.hpp"
+#include "ShaderCompiler.hpp"
+#include "TuningCache.hpp"
+#include "Profiler.hpp"
+#include "CpuBackend.hpp"
+#include "KernelLibrary.hpp"
+#include "ComputeGraph.hpp"
+#include "KernelParams.hpp"
+#include "MpscQueue.hpp"
+#include "NarrowStorage.hpp"
 
 #include <vulkan/vulkan.hpp>
 #include <optional>
+#include <array>
+#include <map>
+#include <span>
+#include <initializer_list>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
 
 #include "vk_mem_alloc.h"
 #include "vk_mem_alloc.hpp"
@@ -17,77 +40,571 @@
 //     vma::Allocation allocation;
 // };
 
+/// Mirrors the push constant block of shader.comp with BINDLESS
+struct BindlessParams
+{
+    vk::DeviceAddress input;    // First element of the input range
+    vk::DeviceAddress output;
+    uint32_t count;
+    uint32_t offset;
+    float scale;
+};
+
+/// Memory heap of the buffers of Engine::Compute(), in bytes: with VK_EXT_memory_budget, the usage
+/// of every process and the budget given by the driver, else the allocations of the engine against
+/// 80% of the heap size (estimated by VMA)
+struct MemoryBudget
+{
+    uint64_t usage = 0;
+    uint64_t budget = 0;
+};
+
+/// Result of Engine::ComputeStreaming()
+struct StreamStats
+{
+    size_t chunkCount = 0;
+    double seconds = 0.0;
+    double gigabytesPerSecond = 0.0;    // (input + output bytes) / seconds
+    double dispatchSeconds = 0.0;       // GPU time of the kernels (only when profiling)
+};
+
+/// Result of Engine::Compute(). The GPU stages are only measured when profiling is enabled.
+struct ComputeTimings
+{
+    double uploadSeconds = 0.0;     // GPU time of the staging copies to the device
+    double dispatchSeconds = 0.0;   // GPU time of the kernel
+    double downloadSeconds = 0.0;   // GPU time of the staging copies back
+    double hostSeconds = 0.0;       // The rest: memcpy, recording, submission, wake-up
+    double totalSeconds = 0.0;      // Wall-clock of the whole call
+    uint64_t invocations = 0;       // Compute shader invocations (0 without pipelineStatisticsQuery)
+};
+
+/// Measured by the Engine constructor
+struct StartupStats
+{
+    double seconds = 0.0;               // Whole constructor
+    double pipelineSeconds = 0.0;       // Creating the compute pipeline (SPIR-V to device ISA)
+    bool warmPipelineCache = false;     // A valid pipeline cache has been loaded from disk
+    ShaderCacheStats shaderCache;       // GLSL compiled by shaderc, or found in the SPIR-V cache
+};
+
+/// Where the storage buffers of Compute() live
+enum class MemoryStrategy
+{
+    eAuto,          // Device-local on discrete GPU, host-visible elsewhere (integrated GPU memory is already device-local)
+    eHostVisible,   // The shader accesses mapped host memory directly
+    eDeviceLocal,   // VRAM, filled and read back with staging copies
+};
+
+/// Where Compute( span, span ) runs
+enum class Backend
+{
+    eAuto,  // CPU below the CPU threshold, Vulkan above
+    eGpu,
+    eCpu,
+};
+
 class Engine
 {
+public:
+    static constexpr uint32_t kSlotCount = 3;       // Command buffers in the submission ring
+    static constexpr size_t kHostImportThreshold = 16 << 20;    // Below it, memcpy is cheaper than importing host memory
+    static constexpr size_t kStagingRingSize = 64 << 20;        // For each direction (upload and readback)
+    static constexpr size_t kPoolBlockSize = 64 << 20;          // Block of the buffer pools
+    static constexpr size_t kTransientArenaSize = 8 << 20;      // Transient memory of every slot
+    static constexpr size_t kAutotuneElementCount = 1 << 22;    // Big enough to fill the GPU, small enough to be quick
+    static constexpr uint32_t kAutotuneRuns = 5;                // Timed runs of each candidate (median)
+    static constexpr uint32_t kTransferQueryRange = kSlotCount; // Profiler range of the transfer command buffer (the slots come first)
+    static constexpr uint32_t kCalibrationRuns = 5;             // Timed runs of each backend and size (median)
+    static constexpr uint32_t kLibraryItems = 4;                // Elements of a block for each invocation (scan)
+    static constexpr uint32_t kReduceMaxGroups = 1024;          // Partials of the first reduce pass, one workgroup folds them
+    static constexpr uint32_t kSortItems = 8;                   // Keys of a sort block for each invocation
+    static constexpr uint32_t kSortRadixBits = 4;               // Bits of the digit of a sort pass (16 bins, 8 passes)
+    static constexpr uint32_t kAsyncBatchCount = 4;             // Coalesced submissions of SubmitAsync() in flight
+    static constexpr uint32_t kAsyncBatchSize = 256;            // Jobs of one coalesced submission
+    static constexpr double kBudgetShare = 0.8;                 // Of the memory left in the budget, that a tile may take
+    static constexpr size_t kMinTileSize = 1 << 20;             // Elements, tiles never shrink below it (the driver pages out instead)
+    static constexpr size_t kConvertChunkSize = 4 << 20;        // Elements converted at once by the host, without narrow storage
+
 public:
     Engine();
+    explicit Engine( uint32_t deviceIndex );    // Among the suitable devices, in enumeration order (see CountGpus())
     ~Engine();
-    int Compute();
+
+    /// Physical devices that an engine can run on (compute queue and timeline semaphores)
+    static uint32_t CountGpus();
+
+    /// Run the kernel over input and write the result into output.
+    /// Buffers are grown on demand and reused across calls. A job larger than the memory budget
+    /// allows is split into tiles, processed one after the other with the same buffers.
+    ComputeTimings Compute( std::span<const uint32_t> input, std::span<float> output );
+
+    /// The tiles of Compute( span, span ) take kBudgetShare of what is left in the budget of the heap
+    /// of its buffers, their own buffers included. The budget is read before every tile that is larger
+    /// than the buffers and than kMinTileSize: when other processes take memory, the next tiles are
+    /// smaller and the buffers are allocated again, smaller. Smaller jobs never query the driver.
+    MemoryBudget GetMemoryBudget();
+    void SetMaxTileSize( size_t elementCount );     // Caps the tiles further (0: the budget only)
+
+    /// Same result as Compute(), but the input is split into chunks of chunkSize element that
+    /// are spread over the slots of the ring. While the GPU runs a chunk, the CPU uploads the
+    /// next one and reads back the previous one.
+    StreamStats ComputeStreaming( std::span<const uint32_t> input, std::span<float> output, size_t chunkSize );
+
+    /// ComputeStreaming() from a file of uint32_t to a file of float (raw, native byte order, created
+    /// or truncated). Every chunk is read with pread() straight into the mapped input of its slot and
+    /// written with pwrite() from the mapped output, with no copy on the heap: the memory in use is the
+    /// ring (kSlotCount chunks each way), whatever the size of the files.
+    StreamStats ComputeFile( const std::string& inputPath, const std::string& outputPath, size_t chunkSize );
+
+    /// Run the kernel over ranges that already live in engine memory (no host copy).
+    /// The element count is input.size / sizeof(uint32_t).
+    ComputeTimings Compute( const BufferRange& input, const BufferRange& output );
+
+    /// Compute() with reduced-precision storage: In is uint8_t, uint16_t or uint32_t and Out is Float16
+    /// or float, e.g. Compute<uint8_t, Float16>( input, output ). When the device supports the types
+    /// (IsStorageSupported()), the buffers hold the narrow elements and the kernel converts them on the
+    /// fly, so the copies and the kernel move fewer bytes. Else, and on the CPU backend, the host converts
+    /// kConvertChunkSize elements at a time to and from the 32-bit kernel: same results, no saving.
+    template<typename In, typename Out>
+    ComputeTimings Compute( std::span<const In> input, std::span<Out> output )
+    {
+        return this->ComputeNarrow( input.data(), StorageTypeOf<In>::value, input.size(), output.data(), StorageTypeOf<Out>::value, output.size() );
+    }
+
+    /// The same over ranges in engine memory, only with types that the device supports.
+    /// The element count is input.size / GetStorageSize( inputType ).
+    ComputeTimings Compute( const BufferRange& input, StorageType inputType, const BufferRange& output, StorageType outputType );
+
+    /// Through storageBuffer8BitAccess and storageBuffer16BitAccess, enabled by CreateDevice() when the
+    /// device has them (32-bit types always are). shaderInt8 and shaderFloat16 are enabled too, for the
+    /// graph kernels that compute in narrow types.
+    bool IsStorageSupported( StorageType type ) const;
+
+    /// Compute( input, output ) from any thread, without waiting: the job goes to a lock-free queue,
+    /// a submission thread records the queued jobs into one command buffer (up to kAsyncBatchSize, in
+    /// one vkQueueSubmit with one timeline signal) and a waiter thread fulfils the futures. Jobs of a batch that
+    /// touch the same memory keep their order, the others run concurrently. The batches go to the second
+    /// queue of the compute family when there is one, beside the jobs of the calling threads: the ranges
+    /// have to stay allocated and untouched, and the kernel configuration unchanged, until the future is ready.
+    std::future<void> SubmitAsync( const BufferRange& input, const BufferRange& output );
+
+    /// Long-lived memory, sub-allocated from a pool of big buffers (one pool per intent).
+    /// FreeBuffer() gives the range back once every submission made so far has completed.
+    BufferRange AllocateBuffer( size_t size, BufferIntent intent = BufferIntent::eDeviceLocal );
+    void FreeBuffer( const BufferRange& range );
+
+    /// Deferred destruction: queued behind every submission made so far, destroyed once they
+    /// have completed. The handles are the C handles listed for each DestroyOp.
+    template<typename... Handles>
+    void DestroyDeferred( DestroyOp op, Handles... handles )
+    {
+        m_delQueue.push( op, m_pComputeQueue->submittedValue.load(), handles... );
+    }
+    void CollectGarbage();  // Destroying what has been retired (also done when acquiring a slot)
+
+    /// Every submission to the compute queue signals the next value of its timeline semaphore: its
+    /// ticket. Deferred destruction and the reuse of command buffers wait on the same values. The
+    /// copies of FlushTransfers() run on the transfer queue when the device has one, the dispatches
+    /// submitted after them wait for them on the GPU.
+    uint64_t GetLastTicket() const;             // Of the last submission (0: nothing submitted)
+    bool IsComplete( uint64_t ticket ) const;   // Reads the counter, never waits
+    void Wait( uint64_t ticket ) const;
+
+    /// Without a Vulkan device, the engine still works but only Compute( span, span ) and
+    /// ComputeStreaming() are available, and they run on the CPU backend.
+    bool HasGpu() const;
+    std::string GetDeviceName() const;  // "cpu" without a device
+
+    /// eAuto sends the jobs smaller than the CPU threshold to the CPU backend, where the submission
+    /// latency is not paid. The threshold is the crossover of the two backends, measured by
+    /// CalibrateCpuThreshold() (on the first automatic job, if it has not been called before).
+    void SetBackend( Backend backend );
+    size_t CalibrateCpuThreshold();
+    void SetCpuThreshold( size_t elementCount );
+
+    /// Local size and unroll factor of the kernel. At start, the winner of a previous Autotune()
+    /// on this device is used (else a default within the device limits).
+    const KernelConfig& GetKernelConfig() const;
+    void SetKernelConfig( const KernelConfig& config );
+
+    /// Time every candidate configuration (local size 64 to 1024 within the device limits and
+    /// the subgroup size, unroll 1 to 4) with timestamp queries, apply the fastest one and save
+    /// it for the next engines on this device.
+    KernelConfig Autotune( size_t elementCount = kAutotuneElementCount );
+
+    /// GPU timestamps around every dispatch and staging copy (plus the invocation count, when the
+    /// device has pipelineStatisticsQuery). They are reported by the timings of Compute() and kept
+    /// for WriteTrace(), a Chrome trace of every job since profiling has been enabled.
+    bool IsProfilingSupported() const;
+    void EnableProfiling( bool enable );
+    bool WriteTrace( const std::string& path ) const;
+
+    /// Bindless mode (on by default when the device has bufferDeviceAddress): the pool ranges carry
+    /// their device address, and Compute( BufferRange, BufferRange ), SubmitAsync() and the shader.comp
+    /// stages of Execute() pass the addresses as push constants instead of writing a descriptor set
+    /// for every new pair of ranges. Ranges without an address (imported memory) still use a set.
+    bool IsBindlessSupported() const;
+    void EnableBindless( bool enable );
+
+    /// Kernel library (shaders/library.comp) over ranges that live in engine memory, T is uint32_t,
+    /// int32_t or float. Multi-pass: Reduce() folds the input into one partial per workgroup, then
+    /// folds the partials. Scan() reduces every block, scans the block totals (recursively), then
+    /// scans every block from its offset, so the input is read twice and the output written once.
+    /// Output and input may be the same range.
+    template<typename T>
+    T Reduce( const BufferRange& input, ReduceOp op = ReduceOp::eSum )
+    {
+        T result{};
+        this->ReduceRange( input, op, ElementTypeOf<T>::value, &result );
+        return result;
+    }
+    template<typename T>
+    void Scan( const BufferRange& input, const BufferRange& output, ReduceOp op = ReduceOp::eSum, ScanMode mode = ScanMode::eInclusive )
+    {
+        this->ScanRange( input, output, op, ElementTypeOf<T>::value, mode );
+    }
+
+    /// LSD radix sort in place, stable, every pass in one submission. K is uint32_t, int32_t or
+    /// float (through an order-preserving flip of the bits: -0.0 before 0.0, NaNs at the ends).
+    /// SortByKey() moves 4 bytes values (any type) with their keys. The second copy and the
+    /// histogram come from the engine pools and are kept for the next sorts.
+    template<typename K>
+    void Sort( const BufferRange& keys )
+    {
+        this->SortRange( keys, BufferRange{}, ElementTypeOf<K>::value );
+    }
+    template<typename K>
+    void SortByKey( const BufferRange& keys, const BufferRange& values )
+    {
+        this->SortRange( keys, values, ElementTypeOf<K>::value );
+    }
+
+    /// Every stage of the graph in one command buffer and one submission. Only dependent stages
+    /// are separated by a barrier, the transients are aliased in one range of the device-local
+    /// pool, freed on return. Uploads to the graph buffers have to be flushed before.
+    /// The group count of an indirect stage is computed on the GPU by a one-invocation dispatch at the
+    /// start of its wave, so sizes that depend on the data never come back to the host.
+    ComputeTimings Execute( const ComputeGraph& graph );
+
+    const StartupStats& GetStartupStats() const;
+    const std::string& GetPipelineCachePath() const;
+
+    /// Memory for the next submission only (host-visible). It comes from the linear arena of the
+    /// slot that the next submission uses, and it is given back when that submission has completed.
+    BufferRange AllocateTransient( size_t size );
+
+    void SetMemoryStrategy( MemoryStrategy strategy );
+
+    /// Copies between host memory and an engine buffer. Device-local buffers go through the staging
+    /// rings, and every copy is batched into one submission by FlushTransfers() (or earlier, when a
+    /// ring is full). Mapped buffers are written directly. Downloaded data is only valid after
+    /// FlushTransfers() returns. Within a batch, uploads are executed before downloads.
+    /// On a device with a transfer-only queue family, the batches run there and overlap the dispatches:
+    /// downloads wait for every dispatch submitted so far, uploads wait for none (FlushTransfers() returns
+    /// at once), so a buffer that a submitted job still reads must not be uploaded to before its ticket.
+    void Upload( const Buffer& dst, size_t dstOffset, const void* data, size_t size );
+    void Upload( const BufferRange& dst, size_t dstOffset, const void* data, size_t size );
+    void Download( const Buffer& src, size_t srcOffset, void* data, size_t size );
+    void Download( const BufferRange& src, size_t srcOffset, void* data, size_t size );
+    void FlushTransfers();
 
 private:
-    void InitializeVulkanBase();
+    void InitializeVulkanBase( uint32_t deviceIndex );
+    void RequireGpu() const;
+    bool UseCpu( size_t elementCount );     // Chosen backend of a job
     void CreatePipelineLayout();
-    void CreatePipeline();
+    vk::UniquePipeline CreatePipeline( const KernelConfig& config );    // shader.comp
+    vk::UniquePipeline CreateBindlessPipeline( const KernelConfig& config );    // shader.comp with BINDLESS
+    vk::UniquePipeline CreatePipeline( const ShaderSource& source, vk::PipelineLayout layout, const KernelConfig& config );
     void CreateDescriptorPool();
-    void AllocateDescriptorSet();
-    void AllocateBuffers( size_t inputSize, size_t outputSize );    // Allocating buffer for input and output
     void PrepareCommandPool();
     void PrepareCommandBuffer();
 
+private: // Buffer
+    /// Input and output buffer with the descriptor set that points to them
+    struct IoBinding
+    {
+        Buffer                  input;          // Owned buffers (empty when the ranges come from elsewhere)
+        Buffer                  output;
+        BufferRange             inputRange;     // What the descriptor set points to
+        BufferRange             outputRange;
+        vk::UniqueDescriptorSet set;
+        size_t                  capacity = 0;   // In element, same for input and output
+        uint64_t                generation = 0; // Increased every time the buffers are re-allocated
+        bool                    deviceLocal = false;    // Else, persistently mapped host memory
+    };
+    vk::UniqueDescriptorSet AllocateDescriptorSet();
+    void AllocateBuffers( IoBinding& binding, size_t inputSize, size_t outputSize );    // Allocating buffer for input and output
+    void ReserveBuffers( IoBinding& binding, size_t elementCount, size_t maxCapacity = SIZE_MAX );   // Grow (geometrically) the input and output buffer
+    void UpdateDescriptorSet( const IoBinding& binding );
+    void DestroyBuffers( IoBinding& binding );
+    bool CanImportHostMemory( const void* hostPointer, size_t size ) const;
+    bool ComputeImported( std::span<const uint32_t> input, std::span<float> output );   // Zero-copy path of Compute(), false if the driver refuses the memory
+    void ComputeGpu( const void* input, StorageType inputType, void* output, StorageType outputType, size_t elementCount );   // Vulkan path of Compute()
+    ComputeTimings ComputeNarrow( const void* input, StorageType inputType, size_t inputCount, void* output, StorageType outputType, size_t outputCount );
+    vk::Pipeline GetStoragePipeline( StorageType inputType, StorageType outputType );   // shader.comp variant, m_pPipeline for 32-bit types
+    size_t GetTileSize( size_t elementCount );  // Elements of the next tile of Compute() (elementCount left), from the budget
+    uint32_t FindBudgetHeap( bool deviceLocal ) const;  // Heap of the buffers of Compute(), at device creation
+
+private: // Submission ring
+    /// A command buffer with the timeline value of its last submission. Recorded once and re-submitted as long as
+    /// the element count and the bound buffers do not change.
+    struct Slot
+    {
+        vk::UniqueCommandBuffer cmdBuffer;
+        IoBinding               binding;                // Chunk buffers of ComputeStreaming()
+        IoBinding               rangeBinding;           // Ranges given to Compute( BufferRange, BufferRange )
+        uint64_t                submittedValue = 0;     // Of its last submission (0: never submitted)
+        LinearArena             transientArena;
+        bool                    transientInFlight = false;  // Submitted since the arena was reset
+        vk::DescriptorSet       recordedSet;
+        vk::Pipeline            recordedPipeline;       // Of a recording with a set (storage variants of shader.comp)
+        uint32_t                recordedCount = 0;      // 0 means nothing has been recorded yet
+        uint64_t                recordedGeneration = 0;
+        vk::DeviceAddress       recordedInput = 0;      // Bindless recording, with a null recordedSet
+        vk::DeviceAddress       recordedOutput = 0;
+        size_t                  pendingOffset = 0;      // Output range that is not read back yet
+        size_t                  pendingCount = 0;
+        uint32_t                queryRange = 0;         // Of the profiler
+        bool                    timingPending = false;  // Profiled submission whose timings are not collected yet
+        double                  submitSeconds = 0.0;    // Profiler time of its last submission
+    };
+    Slot& AcquireSlot();    // Waiting the last submission of the next slot in the ring
+
+    /// A queue and its timeline: every submission signals the next value
+    struct DeviceQueue
+    {
+        vk::Queue               queue;
+        uint32_t                family = 0;
+        vk::UniqueSemaphore     timeline;
+        std::atomic<uint64_t>   submittedValue = 0;     // Signaled by the last submission (0: nothing submitted)
+        std::mutex              mutex;                  // Every vkQueueSubmit, the submission thread submits too
+    };
+    struct QueueFamilies
+    {
+        uint32_t                compute = 0;    // Without graphics if the device has one (async compute)
+        uint32_t                computeCount = 0;
+        std::optional<uint32_t> transfer;       // Transfer-only family (DMA engines)
+    };
+    uint64_t GetCompletedValue( const DeviceQueue& queue ) const;   // Every submission up to this value has completed
+    /// Signals the next value of the queue timeline, returned. With pWaitQueue, the submission first waits
+    /// on the GPU for the last submission of that queue (unless it is the same queue or it has completed).
+    uint64_t SubmitTimeline( DeviceQueue& queue, vk::CommandBuffer cmdBuffer, const DeviceQueue* pWaitQueue = nullptr );
+    void WaitTimeline( const DeviceQueue& queue, uint64_t value ) const;    // On the host, returns at once if it has completed
+    std::vector<uint32_t> SharedQueueFamilies() const;     // Of the device-local buffers, concurrent if the queues differ
+    void Submit( Slot& slot, const IoBinding& binding, uint32_t elementCount, vk::Pipeline pipeline );
+    void Submit( Slot& slot, const BufferRange& input, const BufferRange& output, uint32_t elementCount );   // Bindless
+    void SubmitRecorded( Slot& slot );
+    void RecordCommandBuffer( Slot& slot, const std::function<void( vk::CommandBuffer )>& recordDispatch );   // Within the queries of the slot
+    void RecordDispatch( vk::CommandBuffer cmdBuffer, vk::Pipeline pipeline, const KernelConfig& config, vk::DescriptorSet set, uint32_t elementCount, float scale = ComputeGraph::kDefaultScale ) const;
+    void RecordDispatch( vk::CommandBuffer cmdBuffer, vk::Pipeline pipeline, const KernelConfig& config, const BufferRange& input, const BufferRange& output, uint32_t elementCount, float scale = ComputeGraph::kDefaultScale ) const;
+    /// vkCmdDispatchIndirect over the group count of dispatchArgs, that RecordDispatchArgs() has written before
+    void RecordIndirectDispatch( vk::CommandBuffer cmdBuffer, vk::Pipeline pipeline, vk::DescriptorSet set, const BufferRange& dispatchArgs, uint32_t maxCount, float scale ) const;
+    void RecordDispatchArgs( vk::CommandBuffer cmdBuffer, vk::Pipeline pipeline, vk::DescriptorSet set, const KernelConfig& config, uint32_t maxCount ) const;   // dispatch.comp
+    bool UseBindless( const BufferRange& input, const BufferRange& output ) const;
+    /// Copy of a chunk between a mapped buffer of the ring and where the stream comes from or goes to
+    using ChunkCopy = std::function<void( const Buffer& buffer, size_t offset, size_t count )>;
+    StreamStats StreamChunks( const char* name, size_t elementCount, size_t chunkSize, const ChunkCopy& fill, const ChunkCopy& drain );
+    void DrainSlot( Slot& slot, const ChunkCopy& drain );   // Output of its last chunk
+    void CollectTimings( Slot& slot );  // Once its submission has been waited
+    ComputeTimings FinishTimings( const char* name, double startSeconds );
+
+private: // Staging
+    struct PendingCopy
+    {
+        vk::Buffer      buffer;     // Destination of an upload, source of a download
+        vk::BufferCopy  region;
+    };
+    struct PendingDownload
+    {
+        BufferRange     source;     // Range of the readback ring, or the mapped range itself
+        size_t          offset;
+        void*           data;
+        size_t          size;
+    };
+    void ReserveStaging();
+    void RecordTransfers( vk::CommandBuffer cmdBuffer, bool onComputeQueue, const std::function<void( vk::CommandBuffer )>& recordDispatch = {} ) const;   // Transfer-only queues have no compute stage
+    void RecordCopies( vk::CommandBuffer cmdBuffer, bool uploads ) const;   // One vkCmdCopyBuffer for every run of copies with the same buffer
+    /// FlushTransfers() with a dispatch between the uploads and the downloads, waited once on the host: one
+    /// command buffer on the compute queue, or with a transfer queue, three submissions chained by their timelines
+    void FlushTransfersAround( const std::function<void( vk::CommandBuffer )>& recordDispatch );
+    void WaitStaging() const;   // For the last copies that read or write the rings
+
+private: // Tuning
+    KernelConfig DefaultKernelConfig() const;
+    bool IsKernelConfigSupported( const KernelConfig& config ) const;
+    std::vector<KernelConfig> AutotuneCandidates() const;
+    double TimeDispatch( vk::Pipeline pipeline, const KernelConfig& config, vk::DescriptorSet set, uint32_t elementCount );   // In second
+
+private: // Kernel library
+    /// Levels of a scan: the block totals of a level are the elements of the next one
+    struct ScanPlan
+    {
+        std::vector<uint32_t>   counts;         // Elements of every level, the last one is a single block
+        std::vector<size_t>     offsets;        // In the scratch range, of every level below the first one
+        size_t                  scratchSize = 0;
+    };
+    void ReduceRange( const BufferRange& input, ReduceOp op, ElementType type, void* result );
+    void ScanRange( const BufferRange& input, const BufferRange& output, ReduceOp op, ElementType type, ScanMode mode );
+    void SortRange( const BufferRange& keys, const BufferRange& values, ElementType keyType );  // Without values if values.size is 0
+    vk::Pipeline GetLibraryPipeline( LibraryKernel kernel, ReduceOp op, ElementType type, ScanMode mode = ScanMode::eInclusive );
+    vk::Pipeline GetCachedPipeline( const ShaderSource& source, vk::PipelineLayout layout, const KernelConfig& config );  // Created on first use
+    KernelConfig LibraryKernelConfig() const;
+    vk::UniqueDescriptorSet AllocateLibrarySet( vk::DescriptorSetLayout layout, std::initializer_list<BufferRange> ranges );   // One range for each binding
+    void RecordLibraryDispatch( vk::CommandBuffer cmdBuffer, vk::PipelineLayout layout, vk::Pipeline pipeline, vk::DescriptorSet set, LibraryParams params, uint32_t groupCount ) const;
+    uint32_t GetLibraryBlockCount( uint32_t elementCount, uint32_t items ) const;
+    ScanPlan PlanScan( uint32_t elementCount ) const;
+    std::vector<vk::UniqueDescriptorSet> AllocateScanSets( const ScanPlan& plan, const BufferRange& input, const BufferRange& output, const BufferRange& scratch );
+    void RecordScan( vk::CommandBuffer cmdBuffer, const ScanPlan& plan, const std::vector<vk::UniqueDescriptorSet>& sets, ReduceOp op, ElementType type, ScanMode mode );
+
+private: // Asynchronous submission
+    struct AsyncJob
+    {
+        BufferRange         input;
+        BufferRange         output;
+        uint32_t            elementCount = 0;
+        std::promise<void>  promise;
+    };
+    /// Command buffer and descriptor sets of one coalesced submission
+    struct AsyncBatch
+    {
+        vk::UniqueCommandBuffer     cmdBuffer;
+        uint64_t                    submittedValue = 0;
+        vk::UniqueDescriptorPool    descPool;   // kAsyncBatchSize sets, reset by every batch
+        std::vector<AsyncJob>       jobs;
+    };
+    void StartAsync();      // On the first SubmitAsync()
+    void StopAsync();       // The queued jobs are still executed
+    void SubmitLoop();      // Submission thread
+    void WaitLoop();        // Waiter thread
+    void RecordBatch( AsyncBatch& batch );
+
 private: // Utility
-    vk::PhysicalDevice PickPhysicalDevice(const std::vector<vk::QueueFlagBits>& flags) const;
+    vk::CommandBuffer BeginImmediate();     // The immediate command buffer, recording
+    void SubmitImmediate();                 // Submitting it and waiting for it
+    vk::PhysicalDevice PickPhysicalDevice( uint32_t deviceIndex ) const;   // Null if there are not that many
+    static bool IsPhysicalDeviceSuitable( const vk::PhysicalDevice& physicalDevice );
     vk::UniqueDevice CreateDevice() const;
-    std::vector<char> readFile( const std::string& fileName, bool isSPIRV = true ) const;
-    vk::UniqueShaderModule CreateShaderModule( const std::string& fileName ) const;
+    vk::UniqueShaderModule CreateShaderModule( const std::vector<uint32_t>& spirv ) const;
     std::vector<const char*> InstanceExtensions() const;
     std::vector<const char*> InstanceValidations() const;
-    std::vector<std::optional<size_t>> FindQueueFamilyIndices( const vk::PhysicalDevice& physicalDevice, const std::vector<vk::QueueFlagBits>& flags ) const;
+    std::vector<const char*> DeviceExtensions() const;
+    bool IsDeviceExtensionSupported( const char* extensionName ) const;
+    static std::optional<QueueFamilies> FindQueueFamilies( const vk::PhysicalDevice& physicalDevice );  // Empty without compute
     // Buffer CreateBuffer( size_t allocSize, vk::BufferUsageFlags bufferUsageFlag, vma::MemoryUsage memoryUsage ) const;
 
 private:
+    /// The buffers are persistently mapped, so copying is only a memcpy (plus flush/invalidate on non-coherent memory)
     template<typename T>
-    void CopyToBuffer( T* dataToCopy, size_t dataSize, Buffer dstBuffer )
+    void CopyToBuffer( T* dataToCopy, size_t dataSize, const Buffer& dstBuffer )
     {
-        void* data;
-        if( m_allocator.mapMemory( dstBuffer.GetAllocation(), &data ) != vk::Result::eSuccess )
-            throw std::runtime_error("Failed to mapping memory\n");
-        memcpy( data, dataToCopy, dataSize );
-        m_allocator.unmapMemory( dstBuffer.GetAllocation() );
+        memcpy( dstBuffer.GetMappedData(), dataToCopy, dataSize );
+        dstBuffer.Flush( 0, dataSize );
     }
     template<typename T>
-    void CopyFromBuffer( T* variable, size_t dataSize, Buffer srcBuffer )
+    void CopyFromBuffer( T* variable, size_t dataSize, const Buffer& srcBuffer )
     {
-        void* data;
-        if( m_allocator.mapMemory( srcBuffer.GetAllocation(), &data ) != vk::Result::eSuccess )
-            throw std::runtime_error("Failed to mapping memory\n");
-        memcpy( variable, data, dataSize );
-        m_allocator.unmapMemory( srcBuffer.GetAllocation() );
+        srcBuffer.Invalidate( 0, dataSize );
+        memcpy( variable, srcBuffer.GetMappedData(), dataSize );
     }
 
 private:
     DeletionQueue                           m_delQueue; // For non-smart-pointer (raw heap's allocation) variable
-    uint32_t                                m_queueFamilyIndex;
-    const std::vector<vk::QueueFlagBits>    m_queueFlags = { vk::QueueFlagBits::eCompute };
     vma::Allocator                          m_allocator;
 
-private: // Buffer
-    int inputData[1000];
-    Buffer m_inputBuffer;
-    float outputData[1000];
-    Buffer m_outputBuffer;
+private:
+    uint32_t m_maxGroupCountX = 0;
+    uint32_t m_maxGroupSizeX = 0;
+    uint32_t m_maxGroupInvocations = 0;
+    uint32_t m_subgroupSize = 1;
+    bool m_subgroupArithmetic = false;  // Subgroup arithmetic in compute shaders
+    uint32_t m_libraryLocalSize = 1;    // Power of two (and multiple of the subgroup size with subgroup arithmetic)
+    uint32_t m_timestampValidBits = 0;  // 0 if the compute queue does not support timestamps
+    float m_timestampPeriod = 1.0f;     // Nanoseconds per timestamp tick
+    size_t m_hostImportAlignment = 0;   // 0 if VK_EXT_external_memory_host is not supported
+    StartupStats m_startupStats;
+    ShaderCompiler m_shaderCompiler;
+    TuningCache m_tuningCache;
+    KernelConfig m_kernelConfig;    // Of m_pPipeline
+    bool m_profiling = false;
+    bool m_bufferDeviceAddress = false; // Supported by the device, enabled by CreateDevice()
+    bool m_bindless = false;
+    bool m_storage8Bit = false;         // storageBuffer8BitAccess, enabled by CreateDevice()
+    bool m_storage16Bit = false;        // storageBuffer16BitAccess
+    bool m_shaderInt8 = false;
+    bool m_shaderFloat16 = false;
+    size_t m_maxTileSize = 0;           // SetMaxTileSize(), 0: no cap
+    uint32_t m_budgetFrameIndex = 0;    // Advanced by every GetMemoryBudget(), for VMA to read the budget again
+    std::array<uint32_t, 2> m_budgetHeaps{};    // FindBudgetHeap() of mapped (0) and device-local (1) buffers
+    ComputeTimings m_timings;       // Of the current call
+    CpuBackend m_cpuBackend;
+    Backend m_backend = Backend::eAuto;
+    std::optional<size_t> m_cpuThreshold;   // Not calibrated yet if empty
+
+private: // Staging
+    LinearArena                     m_uploadRing;
+    LinearArena                     m_readbackRing;
+    std::vector<PendingCopy>        m_uploadCopies;
+    std::vector<PendingCopy>        m_downloadCopies;
+    std::vector<PendingDownload>    m_downloads;
+
+private: // Sub-allocation
+    std::array<BufferPool, 3>       m_pools;    // Indexed by BufferIntent
+    size_t                          m_storageAlignment = 1;     // minStorageBufferOffsetAlignment
 
 private:
     vk::UniqueInstance                          m_pInstance;
     vk::DebugUtilsMessengerEXT                  m_debugUtils;
+    std::vector<const char*>                    m_validationLayers;     // The installed ones of InstanceValidations()
     vk::PhysicalDevice                          m_physicalDevice;
     vk::UniqueDevice                            m_pDevice;
+    std::array<DeviceQueue, 3>                  m_queues;               // Compute, second compute and transfer (if the device has them)
+    DeviceQueue*                                m_pComputeQueue = &m_queues[0];
+    DeviceQueue*                                m_pAsyncQueue = &m_queues[0];       // SubmitAsync(), the compute queue without a second one
+    DeviceQueue*                                m_pTransferQueue = &m_queues[0];    // FlushTransfers(), the compute queue without a transfer-only family
+    PipelineCache                               m_pipelineCache;
+    Profiler                                    m_profiler;
     vk::UniqueCommandPool                       m_pCmdPool;
-    vk::UniqueCommandBuffer                     m_pCmdBuffer;
-    vk::Queue                                   m_computeQueue;
+    vk::UniqueCommandBuffer                     m_pImmediateCmdBuffer;
+    uint64_t                                    m_immediateValue = 0;   // Last submission of the immediate command buffer
+    vk::UniqueCommandPool                       m_pCopyCmdPool;         // Of the transfer-only family
+    vk::UniqueCommandBuffer                     m_pCopyCmdBuffer;
+    vk::UniqueCommandBuffer                     m_pDownloadCmdBuffer;   // Downloads of FlushTransfersAround(), while its uploads may still run
+    uint64_t                                    m_copyValue = 0;        // Last submission of the copy command buffer (transfer queue)
     vk::UniquePipelineLayout                    m_pPipelineLayout;
     vk::UniquePipeline                          m_pPipeline;
+    vk::UniquePipelineLayout                    m_pBindlessLayout;      // Push constants only
+    vk::UniquePipeline                          m_pBindlessPipeline;    // Same configuration as m_pPipeline
     vk::UniqueDescriptorSetLayout               m_pSetLayout;
     vk::UniqueDescriptorPool                    m_pDescPool;
+    vk::UniqueDescriptorSetLayout               m_pLibrarySetLayout;    // Input, output and block totals
+    vk::UniquePipelineLayout                    m_pLibraryLayout;
+    vk::UniqueDescriptorSetLayout               m_pSortSetLayout;       // Keys in and out, histogram, values in and out
+    vk::UniquePipelineLayout                    m_pSortLayout;
+    vk::UniqueDescriptorSetLayout               m_pIndirectSetLayout;   // Input, output and dispatch arguments (indirect stages)
+    vk::UniquePipelineLayout                    m_pIndirectLayout;
+    std::map<std::string, vk::UniquePipeline>   m_libraryPipelines;     // By variant (and graph kernel)
+    Buffer                                      m_libraryResult;        // Where the last reduce pass writes (mapped)
+    BufferRange                                 m_sortScratch;          // From the device-local pool, grown on demand
     // std::vector<vk::UniqueDescriptorSet>        m_pSets;
-    vk::UniqueDescriptorSet                     m_pSet;
+    IoBinding                                   m_binding;  // Used by Compute()
+    IoBinding                                   m_importBinding;    // Wrapping caller's memory (zero copy)
+    std::vector<Slot>                           m_slots;
+    size_t                                      m_slotIndex = 0;
+
+private: // Asynchronous submission
+    MpscQueue<AsyncJob>         m_asyncJobs;
+    std::atomic<uint64_t>       m_asyncPushed = 0;  // Increased (and notified) by every push, the submission thread waits on it
+    std::atomic<bool>           m_asyncStopping = false;
+    std::once_flag              m_asyncStarted;
+    vk::UniqueCommandPool       m_pAsyncCmdPool;    // Only used by the submission thread
+    std::vector<AsyncBatch>     m_asyncBatches;
+    std::mutex                  m_asyncMutex;       // Guards what follows
+    std::condition_variable     m_asyncCondition;
+    std::deque<AsyncBatch*>     m_asyncFree;
+    std::deque<AsyncBatch*>     m_asyncInFlight;    // In submission order
+    bool                        m_asyncSubmitDone = false;
+    std::thread                 m_submitThread;
+    std::thread                 m_waitThread;
 };
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "KernelLibrary.hpp"
+
+namespace
+{
+
+const char* GetTypeName( ElementType type )
+{
+    switch( type )
+    {
+    case ElementType::eUint32:
+        return "uint";
+    case ElementType::eInt32:
+        return "int";
+    case ElementType::eFloat32:
+        return "float";
+    }
+    return "uint";
+}
+
+/// Neutral element of the operator, as a GLSL expression
+const char* GetIdentity( ReduceOp op, ElementType type )
+{
+    switch( op )
+    {
+    case ReduceOp::eSum:
+        return type == ElementType::eFloat32 ? "0.0" : type == ElementType::eInt32 ? "0" : "0u";
+    case ReduceOp::eMin:    // Largest value
+        return type == ElementType::eFloat32 ? "uintBitsToFloat(0x7f800000u)" : type == ElementType::eInt32 ? "0x7fffffff" : "0xffffffffu";
+    case ReduceOp::eMax:    // Smallest value
+        return type == ElementType::eFloat32 ? "uintBitsToFloat(0xff800000u)" : type == ElementType::eInt32 ? "int(0x80000000u)" : "0u";
+    }
+    return "0";
+}
+
+} // namespace
+
+ShaderDefines GetLibraryDefines( LibraryKernel kernel, ReduceOp op, ElementType type, ScanMode mode, bool subgroupArithmetic, uint32_t items )
+{
+    return ShaderDefines{
+        { "KERNEL", std::to_string( static_cast<uint32_t>( kernel ) ) },
+        { "TYPE", GetTypeName( type ) },
+        { "OP", std::to_string( static_cast<uint32_t>( op ) ) },
+        { "IDENTITY", GetIdentity( op, type ) },
+        { "SUBGROUP", subgroupArithmetic ? "1" : "0" },
+        { "INCLUSIVE", mode == ScanMode::eInclusive ? "1" : "0" },
+        { "ITEMS", std::to_string( items ) },
+    };
+}
+
+ShaderDefines GetSortDefines( SortKernel kernel, ElementType keyType, bool values, bool subgroupArithmetic, uint32_t items )
+{
+    return ShaderDefines{
+        { "KERNEL", std::to_string( static_cast<uint32_t>( kernel ) ) },
+        { "KEY_TYPE", std::to_string( static_cast<uint32_t>( keyType ) ) },
+        { "VALUES", values ? "1" : "0" },
+        { "SUBGROUP", subgroupArithmetic ? "1" : "0" },
+        { "ITEMS", std::to_string( items ) },
+    };
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ShaderCompiler.hpp"
+
+#include <cstdint>
+
+/// Kernel library: reductions and prefix scans (shaders/library.comp, Engine::Reduce() and
+/// Engine::Scan()) and radix sort (shaders/sort.comp, Engine::Sort() and Engine::SortByKey())
+/// over the elements of storage buffers. Every variant is a set of macros (kernel, operator,
+/// element type) given to one GLSL source, compiled on first use.
+
+/// Operator of a reduction or a scan
+enum class ReduceOp
+{
+    eSum,   // Wraps around for integers, like the host
+    eMin,
+    eMax,
+};
+
+enum class ScanMode
+{
+    eInclusive,     // output[i] = input[0] op ... op input[i]
+    eExclusive,     // output[i] = input[0] op ... op input[i - 1], output[0] is the identity
+};
+
+/// Element of the library kernels (4 bytes each)
+enum class ElementType
+{
+    eUint32,
+    eInt32,
+    eFloat32,
+};
+
+template<typename T>
+struct ElementTypeOf;   // Only the types of ElementType
+template<>
+struct ElementTypeOf<uint32_t> { static constexpr ElementType value = ElementType::eUint32; };
+template<>
+struct ElementTypeOf<int32_t> { static constexpr ElementType value = ElementType::eInt32; };
+template<>
+struct ElementTypeOf<float> { static constexpr ElementType value = ElementType::eFloat32; };
+
+/// KERNEL macro of library.comp
+enum class LibraryKernel : uint32_t
+{
+    eReduce = 0,        // Grid-stride, one partial per workgroup
+    eBlockReduce = 1,   // Total of every block
+    eBlockScan = 2,     // Scanned blocks, offset by the scanned block totals
+};
+
+/// KERNEL macro of sort.comp
+enum class SortKernel : uint32_t
+{
+    eHistogram = 0,     // Digit counts of every block
+    eScatter = 1,       // Stable move to the scanned digit counts
+};
+
+/// Mirrors the push constant blocks of library.comp and sort.comp
+struct LibraryParams
+{
+    uint32_t count;         // Elements of the input
+    uint32_t firstGroup;    // Used when splitting over maxComputeWorkGroupCount
+    uint32_t hasOffsets;    // library.comp (block scan): binding 2 holds the exclusive scan of the block totals
+    uint32_t shift;         // sort.comp: first bit of the digit
+    uint32_t blockCount;    // sort.comp: blocks of the histogram
+};
+
+/// Macros of a library.comp variant. Without subgroup arithmetic, the workgroup steps go through shared memory.
+ShaderDefines GetLibraryDefines( LibraryKernel kernel, ReduceOp op, ElementType type, ScanMode mode, bool subgroupArithmetic, uint32_t items );
+
+/// Macros of a sort.comp variant (the key type decides the order of the bits, values are moved as they are)
+ShaderDefines GetSortDefines( SortKernel kernel, ElementType keyType, bool values, bool subgroupArithmetic, uint32_t items );
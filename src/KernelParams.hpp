@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+/// Push constants of the kernels, shared by the engine, the graphs and the CPU backend (which
+/// computes what shader.comp does) without the Vulkan headers
+
+/// Mirrors the push constant block of shader.comp
+struct ComputeParams
+{
+    static constexpr float kDefaultScale = 1000.0f;    // outValue = inValue * scale in shader.comp
+
+    uint32_t count;     // Number of valid elements, invocations past it do nothing
+    uint32_t offset;    // First element of this dispatch (used when splitting over maxComputeWorkGroupCount)
+    float scale;        // Factor of the kernel, kDefaultScale unless a graph stage sets another one
+};
+
+/// Mirrors the push constant block of dispatch.comp
+struct DispatchArgsParams
+{
+    uint32_t maxCount;          // Capacity of the indirect stage
+    uint32_t elementsPerGroup;
+};
@@ -0,0 +1,47 @@
+#include "LinearArena.hpp"
+
+LinearArena::LinearArena()
+    :
+    m_alignment( 1 ),
+    m_head( 0 )
+{
+}
+
+LinearArena::LinearArena( vma::Allocator allocator, size_t size, vk::BufferUsageFlags bufferUsageFlag, BufferIntent intent, size_t alignment )
+    :
+    m_buffer( allocator, size, bufferUsageFlag, intent ),
+    m_alignment( alignment ),
+    m_head( 0 )
+{
+}
+
+void LinearArena::Destroy()
+{
+    m_buffer.Destroy();
+    m_head = 0;
+}
+
+std::optional<BufferRange> LinearArena::Allocate( size_t size )
+{
+    auto offset = ( m_head + m_alignment - 1 ) / m_alignment * m_alignment;
+    if( offset + size > m_buffer.GetSize() )
+        return std::nullopt;
+
+    m_head = offset + size;
+    return m_buffer.GetRange( offset, size );
+}
+
+void LinearArena::Reset()
+{
+    m_head = 0;
+}
+
+const Buffer& LinearArena::GetBuffer() const
+{
+    return m_buffer;
+}
+
+size_t LinearArena::GetSize() const
+{
+    return m_buffer.GetSize();
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Buffer.hpp"
+
+#include <optional>
+
+/// One buffer handed out linearly (bump allocation). Everything is released at once by Reset(),
+/// after every submission using the ranges has completed. Used for staging copies and for
+/// per-job transient memory.
+
+class LinearArena
+{
+public:
+    LinearArena();
+    LinearArena( vma::Allocator allocator, size_t size, vk::BufferUsageFlags bufferUsageFlag, BufferIntent intent, size_t alignment = 16 );
+    void Destroy();
+
+    /// std::nullopt if the arena has to be reset first
+    std::optional<BufferRange> Allocate( size_t size );
+    void Reset();
+
+    const Buffer& GetBuffer() const;
+    size_t GetSize() const;
+private:
+    Buffer m_buffer;
+    size_t m_alignment;
+    size_t m_head;
+};
\ No newline at end of file
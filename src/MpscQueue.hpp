@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+/// Unbounded lock-free queue, many producers and one consumer (linked list with a stub node).
+/// Push() is one atomic exchange. Pop() may miss an element whose Push() has not finished yet,
+/// so the consumer retries once the producer has signaled it (Engine::SubmitAsync()).
+
+template<typename T>
+class MpscQueue
+{
+public:
+    MpscQueue()
+        :
+        m_head( new Node ),
+        m_tail( m_head.load( std::memory_order_relaxed ) )
+    {
+    }
+
+    ~MpscQueue()
+    {
+        while( this->Pop() )
+        {
+        }
+        delete m_tail;
+    }
+
+    MpscQueue( const MpscQueue& ) = delete;
+    MpscQueue& operator=( const MpscQueue& ) = delete;
+
+    /// Any thread
+    void Push( T value )
+    {
+        auto pNode = new Node;
+        pNode->value.emplace( std::move( value ) );
+        auto pPrevious = m_head.exchange( pNode, std::memory_order_acq_rel );
+        pPrevious->next.store( pNode, std::memory_order_release );
+    }
+
+    /// The consumer thread only
+    std::optional<T> Pop()
+    {
+        auto pNext = m_tail->next.load( std::memory_order_acquire );
+        if( !pNext )
+            return std::nullopt;
+
+        // The next node becomes the stub, its value is moved out
+        auto value = std::move( pNext->value );
+        pNext->value.reset();
+        delete m_tail;
+        m_tail = pNext;
+        return value;
+    }
+
+private:
+    struct Node
+    {
+        std::atomic<Node*>  next{ nullptr };
+        std::optional<T>    value;
+    };
+
+private:
+    std::atomic<Node*>  m_head;     // Last pushed, producers
+    Node*               m_tail;     // Stub, consumer
+};
@@ -0,0 +1,195 @@
+#include "MultiEngine.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <future>
+#include <stdexcept>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+constexpr double kThroughputBlend = 0.5;    // Weight of the last shard in the refined throughput
+
+} // namespace
+
+MultiEngine::MultiEngine()
+{
+    auto gpuCount = Engine::CountGpus();
+    for( uint32_t i = 0; i < std::max( gpuCount, 1u ); ++i )
+    {
+        m_engines.push_back( std::make_unique<Engine>( i ) );
+
+        // The shares are sized for the GPUs, small jobs are not sent to the CPU behind them
+        if( m_engines.back()->HasGpu() )
+            m_engines.back()->SetBackend( Backend::eGpu );
+    }
+
+    m_activeCount = m_engines.size();
+    if( m_engines.size() > 1 )
+        m_pThreadPool = std::make_unique<ThreadPool>( m_engines.size() );
+}
+
+size_t MultiEngine::GetDeviceCount() const
+{
+    return m_engines.size();
+}
+
+Engine& MultiEngine::GetEngine( size_t device )
+{
+    if( device >= m_engines.size() )
+        throw std::runtime_error("Unknown device of the multi-engine");
+    return *m_engines[device];
+}
+
+void MultiEngine::SetActiveDeviceCount( size_t count )
+{
+    if( count == 0 || count > m_engines.size() )
+        throw std::runtime_error("Active device count out of range");
+    m_activeCount = count;
+}
+
+size_t MultiEngine::GetActiveDeviceCount() const
+{
+    return m_activeCount;
+}
+
+const std::vector<double>& MultiEngine::Calibrate( size_t elementCount )
+{
+    std::vector<uint32_t> input( elementCount, 1 );
+    std::vector<float> output( elementCount );
+
+    /// Every device alone, so that one does not slow the other down through the host
+    m_throughputs.assign( m_engines.size(), 0.0 );
+    for( size_t d = 0; d < m_engines.size(); ++d )
+    {
+        std::vector<double> runs( kCalibrationRuns + 1 );
+        for( auto& run : runs )     // The first one is a warm-up (buffers)
+        {
+            auto start = Clock::now();
+            m_engines[d]->Compute( input, output );
+            run = std::chrono::duration<double>( Clock::now() - start ).count();
+        }
+        std::nth_element( runs.begin() + 1, runs.begin() + 1 + kCalibrationRuns / 2, runs.end() );
+        m_throughputs[d] = static_cast<double>( elementCount ) / std::max( runs[1 + kCalibrationRuns / 2], 1e-9 );
+    }
+
+    return m_throughputs;
+}
+
+const std::vector<double>& MultiEngine::GetThroughputs() const
+{
+    return m_throughputs;
+}
+
+ShardedTimings MultiEngine::Compute( std::span<const uint32_t> input, std::span<float> output )
+{
+    if( output.size() < input.size() )
+        throw std::runtime_error("Output is smaller than input");
+
+    auto timings = ShardedTimings{};
+    if( input.empty() )
+        return timings;
+
+    if( m_activeCount > 1 && m_throughputs.empty() )
+        this->Calibrate();  // Before the timings of this job start
+
+    auto start = Clock::now();
+    auto sizes = this->Partition( input.size() );
+
+    std::vector<std::future<double>> shards( sizes.size() );
+    size_t offset = 0;
+    for( size_t d = 0; d < sizes.size(); ++d )
+    {
+        timings.shards.push_back( ShardStats{ offset, sizes[d], 0.0 } );
+        if( sizes[d] == 0 )
+            continue;
+
+        auto shardInput = input.subspan( offset, sizes[d] );
+        auto shardOutput = output.subspan( offset, sizes[d] );
+        offset += sizes[d];
+
+        auto job = [pEngine = m_engines[d].get(), shardInput, shardOutput](){
+            auto shardStart = Clock::now();
+            pEngine->Compute( shardInput, shardOutput );
+            return std::chrono::duration<double>( Clock::now() - shardStart ).count();
+        };
+        if( m_pThreadPool )
+        {
+            shards[d] = m_pThreadPool->Enqueue( std::move( job ) );
+        }
+        else
+        {
+            auto promise = std::promise<double>{};
+            shards[d] = promise.get_future();
+            promise.set_value( job() );
+        }
+    }
+
+    /// Every shard is waited before an error goes out, the others are still writing the output
+    std::exception_ptr pError;
+    for( size_t d = 0; d < shards.size(); ++d )
+    {
+        if( !shards[d].valid() )
+            continue;
+        try
+        {
+            timings.shards[d].seconds = shards[d].get();
+        }
+        catch( ... )
+        {
+            if( !pError )
+                pError = std::current_exception();
+        }
+    }
+    if( pError )
+        std::rethrow_exception( pError );
+
+    timings.seconds = std::chrono::duration<double>( Clock::now() - start ).count();
+
+    /// The devices are shared with other jobs and their clocks change, the shares follow
+    if( !m_throughputs.empty() )
+    {
+        for( size_t d = 0; d < timings.shards.size(); ++d )
+        {
+            const auto& shard = timings.shards[d];
+            if( shard.elementCount < kCalibrationElementCount || shard.seconds <= 0.0 )
+                continue;   // Mostly submission latency
+            auto measured = static_cast<double>( shard.elementCount ) / shard.seconds;
+            m_throughputs[d] = ( 1.0 - kThroughputBlend ) * m_throughputs[d] + kThroughputBlend * measured;
+        }
+    }
+
+    return timings;
+}
+
+std::vector<size_t> MultiEngine::Partition( size_t elementCount ) const
+{
+    /// Equal shares until the devices are measured
+    auto share = [this]( size_t d ){ return m_throughputs.empty() ? 1.0 : m_throughputs[d]; };
+
+    double total = 0.0;
+    for( size_t d = 0; d < m_activeCount; ++d )
+        total += share( d );
+
+    /// Boundaries on multiples of kShardAlignment, the last one at the end of the input
+    std::vector<size_t> sizes( m_activeCount, 0 );
+    size_t begin = 0;
+    double cumulative = 0.0;
+    for( size_t d = 0; d < m_activeCount; ++d )
+    {
+        cumulative += share( d );
+        auto end = elementCount;
+        if( d + 1 < m_activeCount )
+        {
+            auto exact = static_cast<size_t>( static_cast<double>( elementCount ) * ( cumulative / total ) );
+            end = std::clamp( exact / kShardAlignment * kShardAlignment, begin, elementCount );
+        }
+        sizes[d] = end - begin;
+        begin = end;
+    }
+
+    return sizes;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Engine.hpp"
+#include "ThreadPool.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+/// Part of a MultiEngine::Compute() job, one for each device in use
+struct ShardStats
+{
+    size_t offset = 0;          // First element of the shard
+    size_t elementCount = 0;
+    double seconds = 0.0;       // Wall-clock of the shard on its device (copies included)
+};
+
+/// Result of MultiEngine::Compute()
+struct ShardedTimings
+{
+    double seconds = 0.0;       // Wall-clock of the whole call
+    std::vector<ShardStats> shards;
+};
+
+/// One Engine, and so one logical device, for every GPU of the machine. Compute() splits the input
+/// into one contiguous shard for each device, sized by the measured throughput of the device, runs
+/// the shards concurrently (one thread each) and every device writes its part of the caller's output.
+/// Separate devices rather than a VK_KHR_device_group: the boxes mix GPUs that are not linked.
+
+class MultiEngine
+{
+public:
+    static constexpr size_t kCalibrationElementCount = 1 << 22;     // Big enough to hide the submission latency
+    static constexpr uint32_t kCalibrationRuns = 5;                 // Timed runs of each device (median)
+    static constexpr size_t kShardAlignment = 1024;                 // Elements, the shards start on multiples of it
+
+public:
+    MultiEngine();  // Without any GPU, a single engine on the CPU backend
+
+    size_t GetDeviceCount() const;
+    Engine& GetEngine( size_t device );
+
+    /// Only the first count devices take part in Compute() (all of them by default)
+    void SetActiveDeviceCount( size_t count );
+    size_t GetActiveDeviceCount() const;
+
+    /// Elements per second of every device alone, with the host copies. Measured by the first Compute()
+    /// on more than one device if it has not been called before, then refined by every Compute().
+    const std::vector<double>& Calibrate( size_t elementCount = kCalibrationElementCount );
+    const std::vector<double>& GetThroughputs() const;     // Empty if not calibrated yet
+
+    ShardedTimings Compute( std::span<const uint32_t> input, std::span<float> output );
+
+private:
+    std::vector<size_t> Partition( size_t elementCount ) const;    // Shard sizes of the active devices
+
+private:
+    std::vector<std::unique_ptr<Engine>>    m_engines;      // Engines are not movable
+    std::vector<double>                     m_throughputs;  // By device
+    size_t                                  m_activeCount = 0;
+    std::unique_ptr<ThreadPool>             m_pThreadPool;  // One thread for each device, with more than one
+};
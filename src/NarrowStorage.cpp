@@ -0,0 +1,306 @@
+#include "NarrowStorage.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+    #define CE_CPU_X86 1
+    #include <immintrin.h>
+#elif defined(__aarch64__)
+    #define CE_CPU_NEON 1
+    #include <arm_neon.h>
+#endif
+
+namespace
+{
+
+const char* GetGlslType( StorageType type )
+{
+    switch( type )
+    {
+    case StorageType::eUint32:
+        return "uint";
+    case StorageType::eUint16:
+        return "uint16_t";
+    case StorageType::eUint8:
+        return "uint8_t";
+    case StorageType::eFloat32:
+        return "float";
+    case StorageType::eFloat16:
+        return "float16_t";
+    }
+    return "uint";
+}
+
+/// Kernels of the host conversions, picked once for the CPU
+struct Conversions
+{
+    void (*widen8)( const uint8_t* input, uint32_t* output, size_t count );
+    void (*widen16)( const uint16_t* input, uint32_t* output, size_t count );
+    void (*toHalf)( const float* input, Float16* output, size_t count );
+    void (*fromHalf)( const Float16* input, float* output, size_t count );
+    const char* isaName;
+};
+
+template<typename T>
+void WidenScalar( const T* input, uint32_t* output, size_t count )
+{
+    for( size_t i = 0; i < count; ++i )
+        output[i] = input[i];
+}
+
+uint16_t ToHalf( float value )
+{
+    uint32_t bits;
+    memcpy( &bits, &value, sizeof(bits) );
+    uint32_t sign = ( bits >> 16 ) & 0x8000u;
+    uint32_t magnitude = bits & 0x7fffffffu;
+
+    if( magnitude >= 0x7f800000u )     // Infinity, or a NaN that stays quiet (top of its payload kept)
+        return static_cast<uint16_t>( sign | 0x7c00u | ( magnitude > 0x7f800000u ? 0x0200u | ( ( magnitude >> 13 ) & 0x03ffu ) : 0u ) );
+    if( magnitude >= 0x477ff000u )     // Rounds past 65504
+        return static_cast<uint16_t>( sign | 0x7c00u );
+    if( magnitude < 0x38800000u )
+    {
+        // Below the smallest normal half: adding 0.5 puts the subnormal mantissa in the low bits,
+        // rounded to nearest even by the FPU
+        float shifted;
+        memcpy( &shifted, &magnitude, sizeof(shifted) );
+        shifted += 0.5f;
+        uint32_t shiftedBits;
+        memcpy( &shiftedBits, &shifted, sizeof(shiftedBits) );
+        return static_cast<uint16_t>( sign | ( shiftedBits - 0x3f000000u ) );
+    }
+
+    // Exponent rebiased from 127 to 15, mantissa rounded to nearest even on its 10 top bits
+    uint32_t odd = ( magnitude >> 13 ) & 1u;
+    magnitude += 0xc8000fffu + odd;
+    return static_cast<uint16_t>( sign | ( magnitude >> 13 ) );
+}
+
+float FromHalf( uint16_t half )
+{
+    uint32_t sign = static_cast<uint32_t>( half & 0x8000u ) << 16;
+    uint32_t exponent = ( half >> 10 ) & 0x1fu;
+    uint32_t mantissa = half & 0x03ffu;
+
+    uint32_t bits;
+    if( exponent == 0x1fu )
+        bits = sign | 0x7f800000u | ( mantissa << 13 );
+    else if( exponent != 0 )
+        bits = sign | ( ( exponent + 112 ) << 23 ) | ( mantissa << 13 );
+    else
+    {
+        auto value = std::ldexp( static_cast<float>( mantissa ), -24 );    // Subnormal (or zero), exact
+        return sign != 0 ? -value : value;
+    }
+
+    float value;
+    memcpy( &value, &bits, sizeof(value) );
+    return value;
+}
+
+void ToHalfScalar( const float* input, Float16* output, size_t count )
+{
+    for( size_t i = 0; i < count; ++i )
+        output[i].bits = ToHalf( input[i] );
+}
+
+void FromHalfScalar( const Float16* input, float* output, size_t count )
+{
+    for( size_t i = 0; i < count; ++i )
+        output[i] = FromHalf( input[i].bits );
+}
+
+#if defined(CE_CPU_X86)
+
+__attribute__(( target("avx2") ))
+void Widen8Avx2( const uint8_t* input, uint32_t* output, size_t count )
+{
+    size_t i = 0;
+    for( ; i + 8 <= count; i += 8 )
+    {
+        auto value = _mm_loadl_epi64( reinterpret_cast<const __m128i*>( input + i ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( output + i ), _mm256_cvtepu8_epi32( value ) );
+    }
+    WidenScalar( input + i, output + i, count - i );
+}
+
+__attribute__(( target("avx2") ))
+void Widen16Avx2( const uint16_t* input, uint32_t* output, size_t count )
+{
+    size_t i = 0;
+    for( ; i + 8 <= count; i += 8 )
+    {
+        auto value = _mm_loadu_si128( reinterpret_cast<const __m128i*>( input + i ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( output + i ), _mm256_cvtepu16_epi32( value ) );
+    }
+    WidenScalar( input + i, output + i, count - i );
+}
+
+__attribute__(( target("avx2,f16c") ))
+void ToHalfF16c( const float* input, Float16* output, size_t count )
+{
+    size_t i = 0;
+    for( ; i + 8 <= count; i += 8 )
+    {
+        auto half = _mm256_cvtps_ph( _mm256_loadu_ps( input + i ), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( output + i ), half );
+    }
+    ToHalfScalar( input + i, output + i, count - i );
+}
+
+__attribute__(( target("avx2,f16c") ))
+void FromHalfF16c( const Float16* input, float* output, size_t count )
+{
+    size_t i = 0;
+    for( ; i + 8 <= count; i += 8 )
+    {
+        auto half = _mm_loadu_si128( reinterpret_cast<const __m128i*>( input + i ) );
+        _mm256_storeu_ps( output + i, _mm256_cvtph_ps( half ) );
+    }
+    FromHalfScalar( input + i, output + i, count - i );
+}
+
+#elif defined(CE_CPU_NEON)
+
+void Widen8Neon( const uint8_t* input, uint32_t* output, size_t count )
+{
+    size_t i = 0;
+    for( ; i + 8 <= count; i += 8 )
+    {
+        auto value = vmovl_u8( vld1_u8( input + i ) );
+        vst1q_u32( output + i, vmovl_u16( vget_low_u16( value ) ) );
+        vst1q_u32( output + i + 4, vmovl_high_u16( value ) );
+    }
+    WidenScalar( input + i, output + i, count - i );
+}
+
+void Widen16Neon( const uint16_t* input, uint32_t* output, size_t count )
+{
+    size_t i = 0;
+    for( ; i + 8 <= count; i += 8 )
+    {
+        auto value = vld1q_u16( input + i );
+        vst1q_u32( output + i, vmovl_u16( vget_low_u16( value ) ) );
+        vst1q_u32( output + i + 4, vmovl_high_u16( value ) );
+    }
+    WidenScalar( input + i, output + i, count - i );
+}
+
+void ToHalfNeon( const float* input, Float16* output, size_t count )
+{
+    size_t i = 0;
+    for( ; i + 4 <= count; i += 4 )
+    {
+        auto half = vcvt_f16_f32( vld1q_f32( input + i ) );     // Rounding of the FPCR, nearest even by default
+        vst1_u16( reinterpret_cast<uint16_t*>( output + i ), vreinterpret_u16_f16( half ) );
+    }
+    ToHalfScalar( input + i, output + i, count - i );
+}
+
+void FromHalfNeon( const Float16* input, float* output, size_t count )
+{
+    size_t i = 0;
+    for( ; i + 4 <= count; i += 4 )
+    {
+        auto half = vreinterpret_f16_u16( vld1_u16( reinterpret_cast<const uint16_t*>( input + i ) ) );
+        vst1q_f32( output + i, vcvt_f32_f16( half ) );
+    }
+    FromHalfScalar( input + i, output + i, count - i );
+}
+
+#endif
+
+Conversions PickConversions()
+{
+    auto conversions = Conversions{ WidenScalar<uint8_t>, WidenScalar<uint16_t>, ToHalfScalar, FromHalfScalar, "scalar" };
+#if defined(CE_CPU_X86)
+    if( __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "f16c" ) )
+        conversions = Conversions{ Widen8Avx2, Widen16Avx2, ToHalfF16c, FromHalfF16c, "avx2" };
+#elif defined(CE_CPU_NEON)
+    conversions = Conversions{ Widen8Neon, Widen16Neon, ToHalfNeon, FromHalfNeon, "neon" };    // Always there on AArch64
+#endif
+    return conversions;
+}
+
+const Conversions& GetConversions()
+{
+    static const auto conversions = PickConversions();
+    return conversions;
+}
+
+} // namespace
+
+size_t GetStorageSize( StorageType type )
+{
+    switch( type )
+    {
+    case StorageType::eUint32:
+    case StorageType::eFloat32:
+        return 4;
+    case StorageType::eUint16:
+    case StorageType::eFloat16:
+        return 2;
+    case StorageType::eUint8:
+        return 1;
+    }
+    return 4;
+}
+
+bool IsInputStorage( StorageType type )
+{
+    return type == StorageType::eUint32 || type == StorageType::eUint16 || type == StorageType::eUint8;
+}
+
+bool IsOutputStorage( StorageType type )
+{
+    return type == StorageType::eFloat32 || type == StorageType::eFloat16;
+}
+
+ShaderDefines GetStorageDefines( StorageType input, StorageType output )
+{
+    auto defines = ShaderDefines{
+        { "INPUT_TYPE", GetGlslType( input ) },
+        { "OUTPUT_TYPE", GetGlslType( output ) },
+    };
+    if( input == StorageType::eUint8 )
+        defines["STORAGE_8BIT"] = "1";
+    if( input == StorageType::eUint16 || output == StorageType::eFloat16 )
+        defines["STORAGE_16BIT"] = "1";
+    return defines;
+}
+
+void WidenToUint32( const void* input, StorageType type, uint32_t* output, size_t count )
+{
+    switch( type )
+    {
+    case StorageType::eUint32:
+        memcpy( output, input, count * sizeof(uint32_t) );
+        return;
+    case StorageType::eUint16:
+        GetConversions().widen16( static_cast<const uint16_t*>( input ), output, count );
+        return;
+    case StorageType::eUint8:
+        GetConversions().widen8( static_cast<const uint8_t*>( input ), output, count );
+        return;
+    default:
+        throw std::runtime_error("Not an input storage type");
+    }
+}
+
+void FloatToHalf( const float* input, Float16* output, size_t count )
+{
+    GetConversions().toHalf( input, output, count );
+}
+
+void HalfToFloat( const Float16* input, float* output, size_t count )
+{
+    GetConversions().fromHalf( input, output, count );
+}
+
+const char* GetConversionIsaName()
+{
+    return GetConversions().isaName;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "ShaderCompiler.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+/// Reduced-precision storage of the shader.comp kernel (Engine::Compute() on narrow spans and ranges).
+/// The input may be stored as 8 or 16 bits unsigned integers and the output as half floats: the kernel
+/// still computes in 32 bits, it only converts on load and store, so a bandwidth-bound job moves fewer
+/// bytes. On a device without the 8/16-bit storage features, the host converts to and from the 32-bit
+/// kernel instead (vectorized: AVX2 and F16C, or NEON, picked at runtime like CpuBackend).
+
+/// IEEE 754 binary16, as the GPU stores it (the host has no half type)
+struct Float16
+{
+    uint16_t bits = 0;
+};
+
+/// Element of the input (unsigned integers) or of the output (floats) of shader.comp
+enum class StorageType
+{
+    eUint32,
+    eUint16,
+    eUint8,
+    eFloat32,
+    eFloat16,
+};
+
+template<typename T>
+struct StorageTypeOf;   // Only the types of StorageType
+template<>
+struct StorageTypeOf<uint32_t> { static constexpr StorageType value = StorageType::eUint32; };
+template<>
+struct StorageTypeOf<uint16_t> { static constexpr StorageType value = StorageType::eUint16; };
+template<>
+struct StorageTypeOf<uint8_t> { static constexpr StorageType value = StorageType::eUint8; };
+template<>
+struct StorageTypeOf<float> { static constexpr StorageType value = StorageType::eFloat32; };
+template<>
+struct StorageTypeOf<Float16> { static constexpr StorageType value = StorageType::eFloat16; };
+
+size_t GetStorageSize( StorageType type );     // Bytes of an element
+bool IsInputStorage( StorageType type );        // eUint32, eUint16 or eUint8
+bool IsOutputStorage( StorageType type );       // eFloat32 or eFloat16
+
+/// Macros of a shader.comp variant: the element types and the storage extensions they need
+ShaderDefines GetStorageDefines( StorageType input, StorageType output );
+
+/// Host conversions, what the narrow shader.comp variants do on load and store.
+/// Half floats are rounded to nearest even, like the GPU conversion (out of range: infinity).
+void WidenToUint32( const void* input, StorageType type, uint32_t* output, size_t count );   // Input types
+void FloatToHalf( const float* input, Float16* output, size_t count );
+void HalfToFloat( const Float16* input, float* output, size_t count );
+const char* GetConversionIsaName();     // "avx2", "neon" or "scalar"
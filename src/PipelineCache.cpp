@@ -0,0 +1,102 @@
+#include "PipelineCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+PipelineCache::PipelineCache()
+    :
+    m_isWarm( false )
+{
+}
+
+PipelineCache::PipelineCache( vk::Device device, vk::PhysicalDevice physicalDevice, const std::string& directory )
+    :
+    m_device( device ),
+    m_properties( physicalDevice.getProperties() ),
+    m_isWarm( false )
+{
+    /// One file for each device, so several GPUs do not overwrite the cache of each other
+    std::ostringstream fileName;
+    fileName << directory << "/pipeline_cache_" << std::hex << m_properties.vendorID << "_" << m_properties.deviceID << ".bin";
+    m_filePath = fileName.str();
+
+    /// Loading the previous cache (if any, and if it is for this device and driver)
+    std::vector<char> data;
+    std::ifstream file( m_filePath, std::ios::ate | std::ios::binary );
+    if( file.is_open() )
+    {
+        data.resize( static_cast<size_t>( file.tellg() ) );
+        file.seekg( 0 );
+        file.read( data.data(), data.size() );
+        if( !file || !this->IsCompatible( data ) )
+            data.clear();
+    }
+
+    auto cacheInfo = vk::PipelineCacheCreateInfo{};
+    cacheInfo.setInitialDataSize( data.size() );
+    cacheInfo.setPInitialData( data.empty() ? nullptr : data.data() );
+    m_pCache = m_device.createPipelineCacheUnique( cacheInfo );
+    m_isWarm = !data.empty();
+}
+
+void PipelineCache::Save() const
+{
+    if( !m_pCache )
+        return;
+
+    auto data = m_device.getPipelineCacheData( m_pCache.get() );
+
+    auto tmpPath = m_filePath + ".tmp";
+    {
+        std::ofstream file( tmpPath, std::ios::binary | std::ios::trunc );
+        if( !file.is_open() )
+            return;     // Read-only location, the cache is only an optimization
+        file.write( reinterpret_cast<const char*>( data.data() ), data.size() );
+        if( !file )
+            return;
+    }
+    std::rename( tmpPath.c_str(), m_filePath.c_str() );
+}
+
+vk::PipelineCache PipelineCache::Get() const
+{
+    return m_pCache.get();
+}
+
+const std::string& PipelineCache::GetFilePath() const
+{
+    return m_filePath;
+}
+
+bool PipelineCache::IsWarm() const
+{
+    return m_isWarm;
+}
+
+bool PipelineCache::IsCompatible( const std::vector<char>& data ) const
+{
+    /// VkPipelineCacheHeaderVersionOne
+    struct Header
+    {
+        uint32_t headerSize;
+        uint32_t headerVersion;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint8_t  pipelineCacheUUID[VK_UUID_SIZE];
+    };
+    static_assert( sizeof(Header) == 16 + VK_UUID_SIZE );
+
+    if( data.size() < sizeof(Header) )
+        return false;
+
+    Header header;
+    memcpy( &header, data.data(), sizeof(Header) );
+
+    return header.headerSize >= sizeof(Header) &&
+           header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header.vendorID == m_properties.vendorID &&
+           header.deviceID == m_properties.deviceID &&
+           memcmp( header.pipelineCacheUUID, m_properties.pipelineCacheUUID.data(), VK_UUID_SIZE ) == 0;
+}
\ No newline at end of file
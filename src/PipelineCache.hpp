@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <string>
+#include <vector>
+
+/// VkPipelineCache that is loaded from and saved to disk, so the SPIR-V is not compiled to the
+/// device ISA again on every start. The file is only used when its header matches the device
+/// (vendorID, deviceID and pipelineCacheUUID), so a driver update simply starts a cold cache.
+
+class PipelineCache
+{
+public:
+    PipelineCache();
+    PipelineCache( vk::Device device, vk::PhysicalDevice physicalDevice, const std::string& directory );
+
+    void Save() const;  // Written to a temporary file and renamed, never a half-written cache
+    vk::PipelineCache Get() const;
+    const std::string& GetFilePath() const;
+    bool IsWarm() const;    // A valid cache has been loaded from disk
+
+private:
+    bool IsCompatible( const std::vector<char>& data ) const;
+
+private:
+    vk::Device                      m_device;
+    vk::PhysicalDeviceProperties    m_properties;
+    std::string                     m_filePath;
+    bool                            m_isWarm;
+    vk::UniquePipelineCache         m_pCache;
+};
\ No newline at end of file
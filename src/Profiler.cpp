@@ -0,0 +1,156 @@
+#include "Profiler.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+Profiler::Profiler()
+    :
+    m_timestampPeriod( 1.0f ),
+    m_timestampMask( 0 ),
+    m_origin( std::chrono::steady_clock::now() )
+{
+}
+
+Profiler::Profiler( vk::Device device, uint32_t rangeCount, float timestampPeriod, uint32_t timestampValidBits, bool pipelineStatistics )
+    :
+    m_device( device ),
+    m_timestampPeriod( timestampPeriod ),
+    m_timestampMask( timestampValidBits >= 64 ? UINT64_MAX : ( uint64_t(1) << timestampValidBits ) - 1 ),
+    m_origin( std::chrono::steady_clock::now() )
+{
+    auto timestampInfo = vk::QueryPoolCreateInfo{};
+    timestampInfo.setQueryType( vk::QueryType::eTimestamp );
+    timestampInfo.setQueryCount( rangeCount * kTimestampsPerRange );
+    m_pTimestampPool = m_device.createQueryPoolUnique( timestampInfo );
+
+    if( pipelineStatistics )
+    {
+        auto statisticsInfo = vk::QueryPoolCreateInfo{};
+        statisticsInfo.setQueryType( vk::QueryType::ePipelineStatistics );
+        statisticsInfo.setQueryCount( rangeCount );
+        statisticsInfo.setPipelineStatistics( vk::QueryPipelineStatisticFlagBits::eComputeShaderInvocations );
+        m_pStatisticsPool = m_device.createQueryPoolUnique( statisticsInfo );
+    }
+}
+
+void Profiler::CmdReset( vk::CommandBuffer cmdBuffer, uint32_t range ) const
+{
+    cmdBuffer.resetQueryPool( m_pTimestampPool.get(), range * kTimestampsPerRange, kTimestampsPerRange );
+    if( m_pStatisticsPool )
+        cmdBuffer.resetQueryPool( m_pStatisticsPool.get(), range, 1 );
+}
+
+void Profiler::CmdTimestamp( vk::CommandBuffer cmdBuffer, uint32_t range, uint32_t index, vk::PipelineStageFlagBits stage ) const
+{
+    cmdBuffer.writeTimestamp( stage, m_pTimestampPool.get(), range * kTimestampsPerRange + index );
+}
+
+void Profiler::CmdBeginStatistics( vk::CommandBuffer cmdBuffer, uint32_t range ) const
+{
+    if( m_pStatisticsPool )
+        cmdBuffer.beginQuery( m_pStatisticsPool.get(), range, vk::QueryControlFlags{} );
+}
+
+void Profiler::CmdEndStatistics( vk::CommandBuffer cmdBuffer, uint32_t range ) const
+{
+    if( m_pStatisticsPool )
+        cmdBuffer.endQuery( m_pStatisticsPool.get(), range );
+}
+
+double Profiler::GetSeconds( uint32_t range, uint32_t first, uint32_t last ) const
+{
+    auto timestamps = this->GetTimestamps( range, first, last - first + 1 );
+    return this->TicksToSeconds( timestamps.front(), timestamps.back() );
+}
+
+uint64_t Profiler::GetInvocations( uint32_t range ) const
+{
+    if( !m_pStatisticsPool )
+        return 0;
+
+    uint64_t invocations = 0;
+    auto result = m_device.getQueryPoolResults( m_pStatisticsPool.get(), range, 1, sizeof(invocations), &invocations, sizeof(uint64_t),
+                                                vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait );
+    if( result != vk::Result::eSuccess )
+        throw std::runtime_error("Failed to get pipeline statistics");
+    return invocations;
+}
+
+double Profiler::Now() const
+{
+    return std::chrono::duration<double>( std::chrono::steady_clock::now() - m_origin ).count();
+}
+
+void Profiler::AddHostEvent( const char* name, double startSeconds, double seconds )
+{
+    m_events.push_back( { name, 0, startSeconds, seconds } );
+}
+
+double Profiler::AddGpuEvent( const char* name, uint32_t range, uint32_t first, uint32_t last, double submitSeconds )
+{
+    // From the first timestamp of the range, which is placed at the submission
+    auto timestamps = this->GetTimestamps( range, 0, last + 1 );
+    auto start = submitSeconds + this->TicksToSeconds( timestamps[0], timestamps[first] );
+    auto seconds = this->TicksToSeconds( timestamps[first], timestamps[last] );
+
+    m_events.push_back( { name, 1, start, seconds } );
+    return seconds;
+}
+
+void Profiler::ClearEvents()
+{
+    m_events.clear();
+}
+
+bool Profiler::WriteTrace( const std::string& path ) const
+{
+    auto tmpPath = path + ".tmp";
+    {
+        std::ofstream file( tmpPath, std::ios::trunc );
+        if( !file.is_open() )
+            return false;
+
+        /// Trace Event Format, complete events ("X") in microsecond
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"Host\"}},\n";
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+        for( const auto& event : m_events )
+        {
+            file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.track
+                 << ",\"ts\":" << event.startSeconds * 1e6 << ",\"dur\":" << event.seconds * 1e6 << "}";
+        }
+        file << "\n]}\n";
+        if( !file )
+            return false;
+    }
+    return std::rename( tmpPath.c_str(), path.c_str() ) == 0;
+}
+
+bool Profiler::IsInitialized() const
+{
+    return static_cast<bool>( m_pTimestampPool );
+}
+
+bool Profiler::HasPipelineStatistics() const
+{
+    return static_cast<bool>( m_pStatisticsPool );
+}
+
+std::vector<uint64_t> Profiler::GetTimestamps( uint32_t range, uint32_t first, uint32_t count ) const
+{
+    std::vector<uint64_t> timestamps( count );
+    auto result = m_device.getQueryPoolResults( m_pTimestampPool.get(), range * kTimestampsPerRange + first, count,
+                                                count * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t),
+                                                vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait );
+    if( result != vk::Result::eSuccess )
+        throw std::runtime_error("Failed to get timestamps");
+    return timestamps;
+}
+
+double Profiler::TicksToSeconds( uint64_t begin, uint64_t end ) const
+{
+    // Only the valid bits are meaningful, and the counter may wrap around between the two
+    uint64_t ticks = ( ( end & m_timestampMask ) - ( begin & m_timestampMask ) ) & m_timestampMask;
+    return static_cast<double>( ticks ) * m_timestampPeriod * 1e-9;
+}
\ No newline at end of file
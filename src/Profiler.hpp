@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// GPU timestamps (and compute invocation counts) of the engine's command buffers.
+/// Queries are grouped in ranges, one for each command buffer that is profiled (a slot of the ring,
+/// the transfer command buffer). A range is reset inside its own command buffer, so a pre-recorded
+/// command buffer can be submitted again. Results are read once the submission has completed.
+///
+/// GPU events are also kept for a Chrome trace (chrome://tracing, Perfetto). The GPU clock is not
+/// calibrated against the host clock: the first timestamp of a submission is placed at the host time
+/// of the submission, so the stages of a submission are exact and the submissions are approximately aligned.
+
+class Profiler
+{
+public:
+    static constexpr uint32_t kTimestampsPerRange = 4;    // Slots use 2, the transfer range 4 (start, uploads, dispatch, downloads)
+
+public:
+    Profiler();
+    Profiler( vk::Device device, uint32_t rangeCount, float timestampPeriod, uint32_t timestampValidBits, bool pipelineStatistics );
+
+    /// Recording
+    void CmdReset( vk::CommandBuffer cmdBuffer, uint32_t range ) const;
+    void CmdTimestamp( vk::CommandBuffer cmdBuffer, uint32_t range, uint32_t index, vk::PipelineStageFlagBits stage ) const;
+    void CmdBeginStatistics( vk::CommandBuffer cmdBuffer, uint32_t range ) const;     // No-op without pipeline statistics
+    void CmdEndStatistics( vk::CommandBuffer cmdBuffer, uint32_t range ) const;
+
+    /// Reading back, once the submission has completed
+    double GetSeconds( uint32_t range, uint32_t first, uint32_t last ) const;  // Between two timestamps of the range
+    uint64_t GetInvocations( uint32_t range ) const;   // 0 without pipeline statistics
+
+    /// Chrome trace. The times are in second since the profiler has been created.
+    double Now() const;
+    void AddHostEvent( const char* name, double startSeconds, double seconds );
+    double AddGpuEvent( const char* name, uint32_t range, uint32_t first, uint32_t last, double submitSeconds );  // Returns the duration
+    void ClearEvents();
+    bool WriteTrace( const std::string& path ) const;
+
+    bool IsInitialized() const;
+    bool HasPipelineStatistics() const;
+
+private:
+    std::vector<uint64_t> GetTimestamps( uint32_t range, uint32_t first, uint32_t count ) const;
+    double TicksToSeconds( uint64_t begin, uint64_t end ) const;
+
+private:
+    struct TraceEvent
+    {
+        const char* name;       // String literal
+        uint32_t    track;      // 0: host, 1: GPU
+        double      startSeconds;
+        double      seconds;
+    };
+
+private:
+    vk::Device                              m_device;
+    float                                   m_timestampPeriod;  // Nanoseconds per tick
+    uint64_t                                m_timestampMask;    // The valid bits of a timestamp
+    std::chrono::steady_clock::time_point   m_origin;
+    std::vector<TraceEvent>                 m_events;
+    vk::UniqueQueryPool                     m_pTimestampPool;
+    vk::UniqueQueryPool                     m_pStatisticsPool;  // Empty without pipeline statistics
+};
\ No newline at end of file
@@ -0,0 +1,190 @@
+#include "ShaderCompiler.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <shaderc/shaderc.hpp>
+
+namespace
+{
+
+/// Part of every key: increase it when the compile options below change
+constexpr const char* kCompileOptions = "v1;O=performance;env=vulkan1.3;entry=main";
+
+constexpr uint32_t kSpirvMagic = 0x07230203;
+
+/// SPIR-V already compiled by this process, keyed like the files on disk
+std::mutex s_memoryCacheMutex;
+std::unordered_map<std::string, std::vector<uint32_t>> s_memoryCache;
+
+/// FNV-1a (64 bits), good enough to address a few hundred kernels
+uint64_t Fnv1a( uint64_t hash, const std::string& data )
+{
+    for( unsigned char c : data )
+    {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash ^ 0xff;     // Separator, so ("ab", "c") and ("a", "bc") differ
+}
+
+} // namespace
+
+ShaderCompiler::ShaderCompiler( const std::string& cacheDirectory )
+    :
+    m_cacheDirectory( cacheDirectory )
+{
+    std::error_code error;
+    std::filesystem::create_directories( m_cacheDirectory, error );     // Without it, only the memory cache is used
+}
+
+std::vector<uint32_t> ShaderCompiler::Compile( const std::string& path, const ShaderDefines& defines )
+{
+    auto source = this->ReadSource( path );
+    auto key = this->GetCacheKey( source, defines );
+
+    /// Compiled by this process already
+    {
+        std::lock_guard<std::mutex> lock( s_memoryCacheMutex );
+        auto it = s_memoryCache.find( key );
+        if( it != s_memoryCache.end() )
+        {
+            ++m_memoryHits;
+            return it->second;
+        }
+    }
+
+    /// Compiled by a previous launch
+    std::vector<uint32_t> spirv;
+    if( this->LoadFromDisk( key, spirv ) )
+    {
+        ++m_diskHits;
+    }
+    else
+    {
+        auto options = shaderc::CompileOptions{};
+        options.SetOptimizationLevel( shaderc_optimization_level_performance );
+        options.SetTargetEnvironment( shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_3 );
+        for( const auto& [name, value] : defines )
+            options.AddMacroDefinition( name, value );
+
+        /// One compiler per call, so kernels can be compiled concurrently
+        auto compiler = shaderc::Compiler{};
+        auto result = compiler.CompileGlslToSpv( source, shaderc_compute_shader, path.c_str(), "main", options );
+        if( result.GetCompilationStatus() != shaderc_compilation_status_success )
+            throw std::runtime_error( "Failed to compile " + path + ":\n" + result.GetErrorMessage() );
+
+        spirv.assign( result.cbegin(), result.cend() );
+        this->SaveToDisk( key, spirv );
+        ++m_compilations;
+    }
+
+    std::lock_guard<std::mutex> lock( s_memoryCacheMutex );
+    s_memoryCache.emplace( key, spirv );
+    return spirv;
+}
+
+std::future<std::vector<uint32_t>> ShaderCompiler::CompileAsync( const std::string& path, const ShaderDefines& defines )
+{
+    return this->GetThreadPool().Enqueue( [this, path, defines]() {
+        return this->Compile( path, defines );
+    } );
+}
+
+std::vector<std::vector<uint32_t>> ShaderCompiler::CompileAll( const std::vector<ShaderSource>& sources )
+{
+    if( sources.size() == 1 )
+        return { this->Compile( sources[0].path, sources[0].defines ) };    // Nothing to overlap
+
+    std::vector<std::future<std::vector<uint32_t>>> futures;
+    futures.reserve( sources.size() );
+    for( const auto& source : sources )
+        futures.push_back( this->CompileAsync( source.path, source.defines ) );
+
+    std::vector<std::vector<uint32_t>> results;
+    results.reserve( sources.size() );
+    for( auto& future : futures )
+        results.push_back( future.get() );  // Re-throws the compile error, if any
+    return results;
+}
+
+ShaderCacheStats ShaderCompiler::GetStats() const
+{
+    auto stats = ShaderCacheStats{};
+    stats.memoryHits = m_memoryHits;
+    stats.diskHits = m_diskHits;
+    stats.compilations = m_compilations;
+    return stats;
+}
+
+std::string ShaderCompiler::ReadSource( const std::string& path ) const
+{
+    std::ifstream file( path, std::ios::binary );
+    if( !file.is_open() )
+        throw std::runtime_error( std::string("Failed to open: ") + path );
+
+    std::ostringstream source;
+    source << file.rdbuf();
+    return source.str();
+}
+
+std::string ShaderCompiler::GetCacheKey( const std::string& source, const ShaderDefines& defines ) const
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hash = Fnv1a( hash, kCompileOptions );
+    hash = Fnv1a( hash, source );
+    for( const auto& [name, value] : defines )     // std::map, so the order does not depend on the caller
+    {
+        hash = Fnv1a( hash, name );
+        hash = Fnv1a( hash, value );
+    }
+
+    char key[17];
+    snprintf( key, sizeof(key), "%016llx", static_cast<unsigned long long>( hash ) );
+    return key;
+}
+
+bool ShaderCompiler::LoadFromDisk( const std::string& key, std::vector<uint32_t>& spirv ) const
+{
+    std::ifstream file( m_cacheDirectory + "/" + key + ".spv", std::ios::ate | std::ios::binary );
+    if( !file.is_open() )
+        return false;
+
+    auto fileSize = static_cast<size_t>( file.tellg() );
+    if( fileSize == 0 || fileSize % sizeof(uint32_t) != 0 )
+        return false;
+
+    spirv.resize( fileSize / sizeof(uint32_t) );
+    file.seekg( 0 );
+    file.read( reinterpret_cast<char*>( spirv.data() ), fileSize );
+
+    /// A truncated or foreign file is compiled again (and overwritten)
+    return file && spirv[0] == kSpirvMagic;
+}
+
+void ShaderCompiler::SaveToDisk( const std::string& key, const std::vector<uint32_t>& spirv ) const
+{
+    auto filePath = m_cacheDirectory + "/" + key + ".spv";
+    auto tmpPath = filePath + "." + std::to_string( std::hash<std::thread::id>{}( std::this_thread::get_id() ) ) + ".tmp";     // Same kernel compiled by two threads
+    {
+        std::ofstream file( tmpPath, std::ios::binary | std::ios::trunc );
+        if( !file.is_open() )
+            return;     // Read-only location, the cache is only an optimization
+        file.write( reinterpret_cast<const char*>( spirv.data() ), spirv.size() * sizeof(uint32_t) );
+        if( !file )
+            return;
+    }
+    std::rename( tmpPath.c_str(), filePath.c_str() );
+}
+
+ThreadPool& ShaderCompiler::GetThreadPool()
+{
+    std::lock_guard<std::mutex> lock( m_threadPoolMutex );
+    if( !m_pThreadPool )
+        m_pThreadPool = std::make_unique<ThreadPool>();
+    return *m_pThreadPool;
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "ThreadPool.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// Preprocessor macros given to a kernel (name, value)
+using ShaderDefines = std::map<std::string, std::string>;
+
+/// A kernel to compile: GLSL source file and its macros
+struct ShaderSource
+{
+    std::string     path;
+    ShaderDefines   defines;
+};
+
+/// Where the SPIR-V of Compile() came from
+struct ShaderCacheStats
+{
+    size_t memoryHits = 0;
+    size_t diskHits = 0;
+    size_t compilations = 0;
+};
+
+/// GLSL compute shaders compiled at runtime by shaderc (performance optimization, Vulkan 1.3).
+/// The SPIR-V is content-addressed: the key is a hash of the source, the macros and the compile
+/// options, so an edited source is compiled again and nothing has to be invalidated by hand.
+/// Results are kept in a process-wide memory cache (shared by every Engine) and in
+/// <cacheDirectory>/<key>.spv (shared by every launch).
+
+class ShaderCompiler
+{
+public:
+    explicit ShaderCompiler( const std::string& cacheDirectory );
+
+    std::vector<uint32_t> Compile( const std::string& path, const ShaderDefines& defines = {} );
+    std::future<std::vector<uint32_t>> CompileAsync( const std::string& path, const ShaderDefines& defines = {} );
+
+    /// Independent kernels are compiled in parallel on the thread pool. The result is in the order of sources.
+    std::vector<std::vector<uint32_t>> CompileAll( const std::vector<ShaderSource>& sources );
+
+    ShaderCacheStats GetStats() const;
+
+private:
+    std::string ReadSource( const std::string& path ) const;
+    std::string GetCacheKey( const std::string& source, const ShaderDefines& defines ) const;
+    bool LoadFromDisk( const std::string& key, std::vector<uint32_t>& spirv ) const;
+    void SaveToDisk( const std::string& key, const std::vector<uint32_t>& spirv ) const;
+    ThreadPool& GetThreadPool();    // Created on the first asynchronous compilation
+
+private:
+    std::string                 m_cacheDirectory;
+    std::atomic<size_t>         m_memoryHits = 0;
+    std::atomic<size_t>         m_diskHits = 0;
+    std::atomic<size_t>         m_compilations = 0;
+    std::mutex                  m_threadPoolMutex;
+    std::unique_ptr<ThreadPool> m_pThreadPool;  // Last, so the tasks are done before the rest is destroyed
+};
\ No newline at end of file
@@ -0,0 +1,46 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool( size_t threadCount )
+{
+    threadCount = std::max<size_t>( threadCount, 1 );  // hardware_concurrency() may return 0
+    m_workers.reserve( threadCount );
+    for( size_t i = 0; i < threadCount; ++i )
+        m_workers.emplace_back( &ThreadPool::WorkerLoop, this );
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+
+    /// The queued tasks are still run, nobody waits on a broken promise
+    for( auto& worker : m_workers )
+        worker.join();
+}
+
+size_t ThreadPool::GetThreadCount() const
+{
+    return m_workers.size();
+}
+
+void ThreadPool::WorkerLoop()
+{
+    while( true )
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            m_condition.wait( lock, [this]() { return m_stopping || !m_tasks.empty(); } );
+            if( m_tasks.empty() )
+                return;     // Stopping, and nothing left to run
+            task = std::move( m_tasks.front() );
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// Fixed set of worker threads that run tasks in submission order
+
+class ThreadPool
+{
+public:
+    explicit ThreadPool( size_t threadCount = std::thread::hardware_concurrency() );
+    ~ThreadPool();
+
+    ThreadPool( const ThreadPool& ) = delete;
+    ThreadPool& operator=( const ThreadPool& ) = delete;
+
+    /// The future carries the result (or the exception) of the task
+    template<typename F>
+    auto Enqueue( F&& task ) -> std::future<std::invoke_result_t<F>>
+    {
+        using Result = std::invoke_result_t<F>;
+        auto pTask = std::make_shared<std::packaged_task<Result()>>( std::forward<F>( task ) );
+        auto future = pTask->get_future();
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_tasks.emplace_back( [pTask]() { ( *pTask )(); } );
+        }
+        m_condition.notify_one();
+        return future;
+    }
+
+    size_t GetThreadCount() const;
+
+private:
+    void WorkerLoop();
+
+private:
+    std::vector<std::thread>            m_workers;
+    std::deque<std::function<void()>>   m_tasks;
+    std::mutex                          m_mutex;
+    std::condition_variable             m_condition;
+    bool                                m_stopping = false;
+};
\ No newline at end of file
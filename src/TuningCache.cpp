@@ -0,0 +1,62 @@
+#include "TuningCache.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+TuningCache::TuningCache( vk::PhysicalDevice physicalDevice, const std::string& directory )
+{
+    auto properties = physicalDevice.getProperties();
+    m_driverVersion = properties.driverVersion;
+
+    std::ostringstream fileName;
+    fileName << directory << "/autotune_" << std::hex << properties.vendorID << "_" << properties.deviceID << ".txt";
+    m_filePath = fileName.str();
+
+    /// First line: driver version, then "<kernel> <localSizeX> <unroll> <elementCount>"
+    std::ifstream file( m_filePath );
+    uint32_t driverVersion = 0;
+    if( !( file >> driverVersion ) || driverVersion != m_driverVersion )
+        return;
+
+    std::string kernelName;
+    auto config = KernelConfig{};
+    while( file >> kernelName >> config.localSizeX >> config.unroll >> config.elementCount )
+    {
+        if( config.localSizeX != 0 && config.unroll != 0 )
+            m_entries[kernelName] = config;
+    }
+}
+
+std::optional<KernelConfig> TuningCache::Find( const std::string& kernelName ) const
+{
+    auto it = m_entries.find( kernelName );
+    if( it == m_entries.end() )
+        return std::nullopt;
+    return it->second;
+}
+
+void TuningCache::Store( const std::string& kernelName, const KernelConfig& config )
+{
+    m_entries[kernelName] = config;
+    this->Save();
+}
+
+void TuningCache::Save() const
+{
+    if( m_filePath.empty() )
+        return;
+
+    auto tmpPath = m_filePath + ".tmp";
+    {
+        std::ofstream file( tmpPath, std::ios::trunc );
+        if( !file.is_open() )
+            return;     // Read-only location, the tuning is only applied to this engine
+        file << m_driverVersion << "\n";
+        for( const auto& [kernelName, config] : m_entries )
+            file << kernelName << " " << config.localSizeX << " " << config.unroll << " " << config.elementCount << "\n";
+        if( !file )
+            return;
+    }
+    std::rename( tmpPath.c_str(), m_filePath.c_str() );
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+
+/// Specialization constants of a kernel (constant_id 0, 1 and 2, in this order)
+struct KernelConfig
+{
+    uint32_t localSizeX = 256;
+    uint32_t unroll = 1;            // Elements processed by each invocation
+    uint32_t elementCount = 0;      // 0: the count comes from the push constants, else the pipeline only works for this count
+
+    uint32_t GetElementsPerGroup() const { return localSizeX * unroll; }
+};
+
+/// Winners of Engine::Autotune(), saved to <directory>/autotune_<vendor>_<device>.txt (one line per kernel).
+/// Entries of another driver version are ignored, the driver may have changed what is fastest.
+
+class TuningCache
+{
+public:
+    TuningCache() = default;
+    TuningCache( vk::PhysicalDevice physicalDevice, const std::string& directory );
+
+    std::optional<KernelConfig> Find( const std::string& kernelName ) const;
+    void Store( const std::string& kernelName, const KernelConfig& config );    // The file is written right away
+
+private:
+    void Save() const;
+
+private:
+    std::string                         m_filePath;
+    uint32_t                            m_driverVersion = 0;
+    std::map<std::string, KernelConfig> m_entries;
+};
\ No newline at end of file
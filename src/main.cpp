@@ -2,6 +2,8 @@
 #include "SimpleBenchmark.hpp"
 
 #include <iostream>
+#include <vector>
+#include <numeric>
 
 
 int main()
@@ -10,9 +12,40 @@ int main()
     {
         Engine engine;
 
+        std::vector<uint32_t> inputData( 1000 );
+        std::vector<float> outputData( inputData.size() );
+        std::iota( inputData.begin(), inputData.end(), 0 );
+
+        // GPU timestamps around the copies and the dispatch
+        if( engine.IsProfilingSupported() )
+            engine.EnableProfiling( true );
+
         // Start Computing
-        SimpleBenchmark benchmark;  // Autocalculating if out-of-scope (in destructor)
-        engine.Compute();
+        ComputeTimings timings;
+        {
+            SimpleBenchmark benchmark;  // Autocalculating if out-of-scope (in destructor)
+            timings = engine.Compute( inputData, outputData );
+        }
+        std::cout << "Compute: upload " << timings.uploadSeconds * 1e6 << " us, dispatch " << timings.dispatchSeconds * 1e6
+                  << " us, download " << timings.downloadSeconds * 1e6 << " us, host " << timings.hostSeconds * 1e6
+                  << " us (" << timings.invocations << " invocations)\n";
+
+        for( size_t i = 0; i < inputData.size(); i += 50 )
+        {
+            std::cout << inputData[i] << " -> " << outputData[i] << "\n";
+        }
+
+        // Streaming a bigger array through the ring, 1M element per chunk
+        std::vector<uint32_t> streamInput( 64 << 20 );
+        std::vector<float> streamOutput( streamInput.size() );
+        std::iota( streamInput.begin(), streamInput.end(), 0 );
+
+        auto stats = engine.ComputeStreaming( streamInput, streamOutput, 1 << 20 );
+        std::cout << "Streaming: " << stats.chunkCount << " chunks in " << stats.seconds << " s ("
+                  << stats.gigabytesPerSecond << " GB/s)\n";
+
+        if( engine.IsProfilingSupported() && engine.WriteTrace( "compute_trace.json" ) )
+            std::cout << "Trace written to compute_trace.json (chrome://tracing)\n";
     }
     catch( const vk::SystemError& err )
     {